@@ -0,0 +1,5111 @@
+#define _POSIX_C_SOURCE 200809L         // mkstemp, ftruncate
+#include "sokoban.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define STR_(x) #x
+#define TOSTR(x) STR_(x)
+
+// Sample level (original)
+const char *levelMap[] = {
+        " ########",
+        "##  #   #",
+        "#  $.   #",
+        "#  .$.$ #",
+        "##.$ $.##",
+        "# $.$.@ #",
+        "#   .$  #",
+        "##  #  ##",
+        " ####### ",
+        NULL // Null-terminated array
+};
+
+// Zobrist key for a box (kind 0) or the player (kind 1) on cell c. Keys are
+// mixed on the fly so every level, thread and process agrees on them.
+static inline uint64_t ZobristKey(int c, int kind) {
+    uint64_t z = (uint64_t)(c * 2 + kind) * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Move a box and keep the counters and hash in step
+static inline void LevelMoveBox(Level *lvl, int from, int to) {
+    BB_CLEAR(lvl->boxes, from);
+    BB_SET(lvl->boxes, to);
+    int delta = (int)BB_TEST(lvl->targets, to) - (int)BB_TEST(lvl->targets, from);
+    lvl->boxesOn += delta;
+    lvl->boxesOff -= delta;
+    lvl->hash ^= ZobristKey(from, 0) ^ ZobristKey(to, 0);
+}
+
+static inline void LevelMovePlayer(Level *lvl, int x, int y) {
+    lvl->hash ^= ZobristKey(lvl->py * lvl->w + lvl->px, 1) ^ ZobristKey(y * lvl->w + x, 1);
+    lvl->px = x;
+    lvl->py = y;
+}
+
+// Cell one step from c in direction d, or -1 when it leaves the board
+static int LevelStep(const Level *lvl, int c, int d) {
+    int x = c % lvl->w + dirDX[d], y = c / lvl->w + dirDY[d];
+    if (x < 0 || y < 0 || x >= lvl->w || y >= lvl->h) return -1;
+    return y * lvl->w + x;
+}
+
+// =================== [ Player reachability ] ===================
+// Where the player can walk, worked out 64 cells at a time on the bitboards.
+// Cells are numbered row by row, so a step right is a shift by one bit
+// (masked by rowStart so it cannot wrap into the next row) and a step down is
+// a shift by w bits across words. Used for click-to-move, the corral check and
+// the normalized player cell that state hashes are keyed on.
+
+// Cells of word i the player may stand on
+static inline uint64_t ReachFree(const Level *lvl, int i) {
+    uint64_t free = ~(lvl->walls[i] | lvl->boxes[i]);
+    int tail = (lvl->w * lvl->h) & 63;
+    if (i == lvl->words - 1 && tail) free &= ((uint64_t)1 << tail) - 1;
+    return free;
+}
+
+// Word i of layer b after every cell moves one step in direction d. Cells that
+// would leave the board or wrap to another row drop out.
+static inline uint64_t ReachShift(const Level *lvl, const uint64_t *b, int i, int d) {
+    int words = lvl->words, q = lvl->w >> 6, r = lvl->w & 63;
+    const uint64_t *rs = lvl->rowStart;
+    uint64_t v = 0;
+    switch (d) {
+        case 0:     // up: c - w
+            if (i + q < words) v = b[i + q] >> r;
+            if (r && i + q + 1 < words) v |= b[i + q + 1] << (64 - r);
+            return v;
+        case 1:     // down: c + w
+            if (i - q >= 0) v = b[i - q] << r;
+            if (r && i - q - 1 >= 0) v |= b[i - q - 1] >> (64 - r);
+            return v;
+        case 2:     // left: c - 1, not from the first cell of a row
+            v = (b[i] & ~rs[i]) >> 1;
+            if (i + 1 < words) v |= (b[i + 1] & ~rs[i + 1]) << 63;
+            return v;
+        default:    // right: c + 1, not into the first cell of a row
+            v = b[i] << 1;
+            if (i > 0) v |= b[i - 1] >> 63;
+            return v & ~rs[i];
+    }
+}
+
+// Grow word i of reach by everything next to it, then fill it along its rows
+// (a Kogge-Stone fill covers a whole run of free cells in six steps). Boards
+// narrower than a word also fill between the rows inside it. True when the
+// word changed.
+static bool ReachWord(const Level *lvl, uint64_t *reach, int i) {
+    uint64_t free = ReachFree(lvl, i), rs = lvl->rowStart[i];
+    uint64_t x = (reach[i] | ReachShift(lvl, reach, i, 0) | ReachShift(lvl, reach, i, 1)
+                 | ReachShift(lvl, reach, i, 2) | ReachShift(lvl, reach, i, 3)) & free;
+    if (x == reach[i]) return false;
+    uint64_t old;
+    do {
+        old = x;
+        uint64_t p = free & ~rs;            // cells a step right may enter
+        x |= p & (x << 1);  p &= p << 1;
+        x |= p & (x << 2);  p &= p << 2;
+        x |= p & (x << 4);  p &= p << 4;
+        x |= p & (x << 8);  p &= p << 8;
+        x |= p & (x << 16); p &= p << 16;
+        x |= p & (x << 32);
+        p = free & ~(rs >> 1);              // cells a step left may enter
+        x |= p & (x >> 1);  p &= p >> 1;
+        x |= p & (x >> 2);  p &= p >> 2;
+        x |= p & (x >> 4);  p &= p >> 4;
+        x |= p & (x >> 8);  p &= p >> 8;
+        x |= p & (x >> 16); p &= p >> 16;
+        x |= p & (x >> 32);
+        if (lvl->w < 64) x |= free & (x << lvl->w | x >> lvl->w);
+    } while (lvl->w < 64 && x != old);
+    reach[i] = x;
+    return true;
+}
+
+// Cells the player can walk to (boxes and walls block) into reach[]. The fill
+// sweeps forward, then backward over the words, so one sweep follows any path
+// that only heads right/down or left/up; each sweep starts and stops a row
+// short of where the last one changed anything, and open boards close in two
+// or three sweeps.
+void LevelReach(const Level *lvl, uint64_t *reach) {
+    int words = lvl->words, span = (lvl->w >> 6) + 1;
+    memset(reach, 0, words * sizeof(uint64_t));
+    int start = lvl->py * lvl->w + lvl->px;
+    BB_SET(reach, start);
+    int lo = start >> 6, hi = lo;
+    for (bool forward = true; lo <= hi; forward = !forward) {
+        int first = lo - span < 0 ? 0 : lo - span, last = hi + span >= words ? words - 1 : hi + span;
+        lo = words; hi = -1;
+        if (forward) {
+            for (int i = first; i < words && i <= last; i++) {
+                if (!ReachWord(lvl, reach, i)) continue;
+                if (i < lo) lo = i;
+                hi = i;
+                if (i + span > last) last = i + span;
+            }
+        } else {
+            for (int i = last; i >= 0 && i >= first; i--) {
+                if (!ReachWord(lvl, reach, i)) continue;
+                if (i > hi) hi = i;
+                lo = i;
+                if (i - span < first) first = i - span;
+            }
+        }
+    }
+}
+
+// Normalized player cell: the lowest-numbered cell the player can walk to.
+// Positions that differ only by a walk share it (reach is scratch, words long).
+int LevelNormalPlayer(const Level *lvl, uint64_t *reach) {
+    LevelReach(lvl, reach);
+    for (int i = 0; i < lvl->words; i++)
+        if (reach[i]) return i * 64 + BitIndex(reach[i]);
+    return lvl->py * lvl->w + lvl->px;
+}
+
+// Zobrist hash of the boxes and the normalized player cell; positions that
+// differ only by a walk get the same value, and it equals the solver's node hash
+uint64_t LevelStateHash(const Level *lvl, uint64_t *reach) {
+    int player = lvl->py * lvl->w + lvl->px;
+    return lvl->hash ^ ZobristKey(player, 1) ^ ZobristKey(LevelNormalPlayer(lvl, reach), 1);
+}
+
+// Shortest walk from the player to cell `to`, one wavefront per step over the
+// words the wavefront spans. Cells first reached at step k go to scratch layer
+// k % 3: a cell's neighbours are at most one step nearer or further, so the
+// neighbour in layer (k - 1) % 3 is its predecessor and the path is read back
+// without a distance table. Returns the number of steps (0 = already there,
+// -1 = unreachable) and writes them (direction bytes) to out when they fit in cap.
+int LevelWalkPath(const Level *lvl, int to, unsigned char *out, int cap) {
+    int words = lvl->words, span = (lvl->w >> 6) + 1;
+    int from = lvl->py * lvl->w + lvl->px;
+    if (to < 0 || to >= lvl->w * lvl->h || BB_TEST(lvl->walls, to) || BB_TEST(lvl->boxes, to)) return -1;
+    if (to == from) return 0;
+    uint64_t *layer[3] = { lvl->scratch, lvl->scratch + words, lvl->scratch + 2 * words };
+    memset(lvl->scratch, 0, 3 * words * sizeof(uint64_t));
+    BB_SET(layer[0], from);
+
+    int steps = 0, lo = from >> 6, hi = lo;
+    while (!BB_TEST(layer[steps % 3], to)) {
+        const uint64_t *cur = layer[steps % 3];
+        uint64_t *next = layer[(steps + 1) % 3];
+        int first = lo - span < 0 ? 0 : lo - span, last = hi + span >= words ? words - 1 : hi + span;
+        lo = words; hi = -1;
+        for (int i = first; i <= last; i++) {
+            uint64_t grow = (ReachShift(lvl, cur, i, 0) | ReachShift(lvl, cur, i, 1)
+                           | ReachShift(lvl, cur, i, 2) | ReachShift(lvl, cur, i, 3))
+                          & ReachFree(lvl, i) & ~(layer[0][i] | layer[1][i] | layer[2][i]);
+            if (!grow) continue;
+            next[i] |= grow;
+            if (i < lo) lo = i;
+            hi = i;
+        }
+        if (hi < 0) { steps = -1; break; }
+        steps++;
+    }
+    if (steps > 0 && out && steps <= cap) {
+        for (int k = steps, c = to; k > 0; k--) {
+            for (int d = 0; d < 4; d++) {
+                int n = LevelStep(lvl, c, d);
+                if (n < 0 || !BB_TEST(layer[(k - 1) % 3], n)) continue;
+                out[k - 1] = (unsigned char)(d ^ 1);
+                c = n;
+                break;
+            }
+        }
+    }
+    memset(lvl->scratch, 0, words * sizeof(uint64_t));      // the freeze check's held layer starts clear
+    return steps;
+}
+
+// Walk to the cell behind the box on `box`, then push it one step in
+// direction d. Returns the number of moves (-1 when the push is impossible)
+// and writes them to out when they fit in cap.
+static int PushPathVia(const Level *lvl, const unsigned short *dist, int box, int d, unsigned char *out, int cap) {
+    if (box < 0 || box >= lvl->w * lvl->h || !BB_TEST(lvl->boxes, box)) return -1;
+    int stand = LevelStep(lvl, box, d ^ 1), dest = LevelStep(lvl, box, d);
+    if (stand < 0 || dest < 0 || BB_TEST(lvl->walls, dest) || BB_TEST(lvl->boxes, dest)) return -1;
+    int steps = dist ? LevelWalkPathFrom(lvl, dist, stand, out, cap) : LevelWalkPath(lvl, stand, out, cap);
+    if (steps < 0) return -1;
+    if (out && steps < cap) out[steps] = (unsigned char)(d | MOVE_PUSH);
+    return steps + 1;
+}
+
+int LevelPushPath(const Level *lvl, int box, int d, unsigned char *out, int cap) {
+    return PushPathVia(lvl, NULL, box, d, out, cap);
+}
+
+// Steps from the player to every cell it can walk to (PULL_INF elsewhere),
+// breadth-first through q (one entry per cell). The map holds until a move
+// changes the position, and any number of paths are then read off it by
+// LevelWalkPathFrom / LevelPushPathFrom in time proportional to their length:
+// one map per position instead of one search per hovered cell.
+void LevelWalkDistances(const Level *lvl, unsigned short *dist, unsigned short *q) {
+    int w = lvl->w, cells = w * lvl->h, from = lvl->py * w + lvl->px, qh = 0, qt = 0;
+    // Walls and boxes start out marked as reached, so the loop tests one table
+    for (int i = 0; i < lvl->words; i++) {
+        uint64_t blocked = lvl->walls[i] | lvl->boxes[i];
+        for (int k = 0; k < 64 && i * 64 + k < cells; k++) dist[i * 64 + k] = blocked >> k & 1 ? PULL_INF - 1 : PULL_INF;
+    }
+    dist[from] = 0;
+    q[qt++] = (unsigned short)from;
+    while (qh < qt) {
+        int c = q[qh++], x = c % w;
+        unsigned short next = (unsigned short)(dist[c] + 1);
+        int around[4] = { c - w, c + w, x > 0 ? c - 1 : -1, x + 1 < w ? c + 1 : -1 };
+        for (int d = 0; d < 4; d++) {
+            int n = around[d];
+            if (n < 0 || n >= cells || dist[n] != PULL_INF) continue;
+            dist[n] = next;
+            q[qt++] = (unsigned short)n;
+        }
+    }
+    for (int i = 0; i < lvl->words; i++) {
+        for (uint64_t blocked = lvl->walls[i] | lvl->boxes[i]; blocked; blocked &= blocked - 1)
+            dist[i * 64 + BitIndex(blocked)] = PULL_INF;
+    }
+}
+
+// LevelWalkPath read off a LevelWalkDistances map of the current position;
+// ties break the same way, so the paths are the same
+int LevelWalkPathFrom(const Level *lvl, const unsigned short *dist, int to, unsigned char *out, int cap) {
+    if (to < 0 || to >= lvl->w * lvl->h || dist[to] == PULL_INF) return -1;
+    int steps = dist[to];
+    if (steps > 0 && out && steps <= cap) {
+        for (int k = steps, c = to; k > 0; k--) {
+            for (int d = 0; d < 4; d++) {
+                int n = LevelStep(lvl, c, d);
+                if (n < 0 || dist[n] != k - 1) continue;
+                out[k - 1] = (unsigned char)(d ^ 1);
+                c = n;
+                break;
+            }
+        }
+    }
+    return steps;
+}
+
+int LevelPushPathFrom(const Level *lvl, const unsigned short *dist, int box, int d, unsigned char *out, int cap) {
+    return PushPathVia(lvl, dist, box, d, out, cap);
+}
+// ========================================================================
+
+// =================== [ Deadlock detection ] ===================
+// Dead squares are precomputed once per level by LoadLevel. Freeze and corral
+// checks look only at the box that was just pushed, so they are cheap enough
+// for every TryMove and for the solver's inner loop.
+
+// Fewest pushes that bring a lone box on each cell to the target cell `only`,
+// or to any target when it is -1, found by pulling boxes backwards from the
+// targets. PULL_INF marks a dead square. q is scratch with one entry per cell.
+static void LevelPullDistancesTo(const Level *lvl, int only, unsigned short *dist, unsigned short *q) {
+    int cells = lvl->w * lvl->h;
+    int qh = 0, qt = 0;
+    for (int c = 0; c < cells; c++) {
+        dist[c] = PULL_INF;
+        if (only < 0 ? BB_TEST(lvl->targets, c) : c == only) { dist[c] = 0; q[qt++] = (unsigned short)c; }
+    }
+    while (qh < qt) {
+        int t = q[qh++];
+        int tx = t % lvl->w, ty = t / lvl->w;
+        for (int d = 0; d < 4; d++) {
+            // The box came from p, pushed by a player standing one step further
+            // back at pl; pl on the board means p is too
+            int lx = tx - 2 * dirDX[d], ly = ty - 2 * dirDY[d];
+            if (lx < 0 || ly < 0 || lx >= lvl->w || ly >= lvl->h) continue;
+            int pl = ly * lvl->w + lx, p = t - dirDY[d] * lvl->w - dirDX[d];
+            if (BB_TEST(lvl->walls, p) || BB_TEST(lvl->walls, pl)) continue;
+            if (dist[p] != PULL_INF) continue;
+            dist[p] = (unsigned short)(dist[t] + 1);
+            q[qt++] = (unsigned short)p;
+        }
+    }
+}
+
+static void LevelPullDistances(const Level *lvl, unsigned short *dist, unsigned short *q) {
+    LevelPullDistancesTo(lvl, -1, dist, q);
+}
+
+static void LevelComputeDeadSquares(Level *lvl) {
+    unsigned short *dist = lvl->pullDist;
+    LevelPullDistances(lvl, dist, lvl->queue);
+    memset(lvl->dead, 0, lvl->words * sizeof(uint64_t));
+    for (int c = 0; c < lvl->w * lvl->h; c++) {
+        if (dist[c] == PULL_INF && !BB_TEST(lvl->walls, c)) BB_SET(lvl->dead, c);
+    }
+}
+
+// Freeze test state: boxes under test are "held" (treated as walls) while
+// their neighbours are examined. A failed test releases everything it held;
+// after a successful one the caller releases with FreezeRelease. The held
+// layer is the level's first scratch layer and is all zero between checks.
+#define FREEZE_MAX_CHAIN 64
+typedef struct {
+    const Level *lvl;
+    uint64_t *held;
+    int stack[FREEZE_MAX_CHAIN];
+    int top;
+} FreezeCheck;
+
+static void FreezeRelease(FreezeCheck *fc) {
+    while (fc->top > 0) {
+        fc->top--;
+        BB_CLEAR(fc->held, fc->stack[fc->top]);
+    }
+}
+
+// True when the box on c can never be pushed along either axis
+static bool BoxFrozen(FreezeCheck *fc, int c) {
+    const Level *lvl = fc->lvl;
+    if (fc->top == FREEZE_MAX_CHAIN) return false;   // give up: assume it can move
+    int mark = fc->top;
+    fc->stack[fc->top++] = c;
+    BB_SET(fc->held, c);
+
+    for (int axis = 0; axis < 2; axis++) {
+        int a = LevelStep(lvl, c, axis * 2), b = LevelStep(lvl, c, axis * 2 + 1);
+        bool wallA = a < 0 || BB_TEST(lvl->walls, a) || BB_TEST(fc->held, a);
+        bool wallB = b < 0 || BB_TEST(lvl->walls, b) || BB_TEST(fc->held, b);
+        if (wallA || wallB) continue;
+        if (BB_TEST(lvl->dead, a) && BB_TEST(lvl->dead, b)) continue;
+        if (BB_TEST(lvl->boxes, a) && BoxFrozen(fc, a)) continue;
+        if (BB_TEST(lvl->boxes, b) && BoxFrozen(fc, b)) continue;
+
+        while (fc->top > mark) {
+            fc->top--;
+            BB_CLEAR(fc->held, fc->stack[fc->top]);
+        }
+        return false;
+    }
+    return true;
+}
+
+// A box frozen on its target can seal off an area the player can no longer
+// enter. If every box on that area's border is frozen too, any box left
+// inside off-target (or any empty target inside) stays that way forever.
+static bool CorralDeadlock(const Level *lvl, int c) {
+    uint64_t *reach = lvl->scratch + lvl->words, *seen = lvl->scratch + 2 * lvl->words;
+    unsigned short *q = lvl->queue;
+    LevelReach(lvl, reach);
+    memset(seen, 0, lvl->words * sizeof(uint64_t));
+
+    int qh = 0, qt = 0;
+    bool unfinished = false;
+    BB_SET(seen, c);
+    q[qt++] = (unsigned short)c;
+    while (qh < qt) {
+        int cell = q[qh++];
+        bool box = BB_TEST(lvl->boxes, cell), target = BB_TEST(lvl->targets, cell);
+        if (box != target) unfinished = true;
+        bool border = false;
+        for (int d = 0; d < 4; d++) {
+            int n = LevelStep(lvl, cell, d);
+            if (n < 0 || BB_TEST(lvl->walls, n)) continue;
+            if (BB_TEST(reach, n)) { border = true; continue; }
+            if (BB_TEST(seen, n)) continue;
+            BB_SET(seen, n);
+            q[qt++] = (unsigned short)n;
+        }
+        if (border && box && cell != c) {
+            FreezeCheck fc = { lvl, lvl->scratch, {0}, 0 };
+            if (!BoxFrozen(&fc, cell)) return false;
+            FreezeRelease(&fc);
+        }
+    }
+    return unfinished;
+}
+
+// Deadlock caused by the box standing on cell (call right after pushing it)
+DeadlockKind PushDeadlock(const Level *lvl, int c) {
+    if (BB_TEST(lvl->dead, c)) return DEADLOCK_DEAD_SQUARE;
+
+    FreezeCheck fc = { lvl, lvl->scratch, {0}, 0 };
+    if (!BoxFrozen(&fc, c)) return DEADLOCK_NONE;
+    bool offTarget = false;
+    for (int i = 0; i < fc.top; i++) offTarget |= !BB_TEST(lvl->targets, fc.stack[i]);
+    FreezeRelease(&fc);
+    if (offTarget) return DEADLOCK_FREEZE;
+    return CorralDeadlock(lvl, c) ? DEADLOCK_CORRAL : DEADLOCK_NONE;
+}
+
+// Full check over every box (used after load and undo)
+DeadlockKind LevelDeadlock(const Level *lvl) {
+    for (int i = 0; i < lvl->words; i++) {
+        uint64_t bits = lvl->boxes[i];
+        while (bits) {
+            int c = i * 64 + BitIndex(bits);
+            bits &= bits - 1;
+            DeadlockKind k = PushDeadlock(lvl, c);
+            if (k != DEADLOCK_NONE) return k;
+        }
+    }
+    return DEADLOCK_NONE;
+}
+
+const char *DeadlockText(DeadlockKind k) {
+    switch (k) {
+        case DEADLOCK_DEAD_SQUARE: return "DEADLOCK: box can never reach a target - press U to undo";
+        case DEADLOCK_FREEZE:      return "DEADLOCK: box is frozen off target - press U to undo";
+        case DEADLOCK_CORRAL:      return "DEADLOCK: area sealed off - press U to undo";
+        default:                   return NULL;
+    }
+}
+// ========================================================================
+
+const char *LevelStatusText(LevelStatus st) {
+    switch (st) {
+        case LEVEL_OK:                  return "ok";
+        case LEVEL_EMPTY:               return "empty level";
+        case LEVEL_TOO_BIG:             return "level larger than " TOSTR(MAX_W) "x" TOSTR(MAX_H);
+        case LEVEL_BAD_CHAR:            return "unknown character in level";
+        case LEVEL_NO_PLAYER:           return "no player";
+        case LEVEL_MANY_PLAYERS:        return "more than one player";
+        case LEVEL_BOX_TARGET_MISMATCH: return "box and target counts differ";
+        case LEVEL_NO_MEMORY:           return "out of memory";
+        case LEVEL_CORRUPT:             return "corrupt level data";
+    }
+    return "?";
+}
+
+// Row length without trailing spaces, tabs or CR (ragged rows are padded with floor)
+static int RowLength(const char *row) {
+    int n = (int)strlen(row);
+    while (n > 0 && (row[n-1] == ' ' || row[n-1] == '\t' || row[n-1] == '\r' || row[n-1] == '\n')) n--;
+    return n;
+}
+
+// Counters and hash from a full scan of the layers (LoadLevel, self-check)
+static void LevelRecount(const Level *lvl, int *off, int *on, uint64_t *hash) {
+    int nOff = 0, nOn = 0;
+    uint64_t h = ZobristKey(lvl->py * lvl->w + lvl->px, 1);
+    for (int i = 0; i < lvl->words; i++) {
+        uint64_t bits = lvl->boxes[i];
+        nOn += BitCount(bits & lvl->targets[i]);
+        nOff += BitCount(bits & ~lvl->targets[i]);
+        while (bits) {
+            h ^= ZobristKey(i * 64 + BitIndex(bits), 0);
+            bits &= bits - 1;
+        }
+    }
+    *off = nOff; *on = nOn; *hash = h;
+}
+
+static void MoveLogSnapshot(Level *lvl);
+
+// Point the layers and tables into lvl's arena for a w x h board, growing it
+// when needed. Layout: walls, targets, dead, boxes, 3 scratch layers, the
+// row-start layer, then the pull-distance table and the BFS queue (one
+// unsigned short per cell each).
+static bool LevelArena(Level *lvl, int w, int h) {
+    int words = (w * h + 63) / 64, cells = w * h;
+    size_t bytes = (size_t)words * 8 * sizeof(uint64_t) + (size_t)cells * 2 * sizeof(unsigned short);
+    if (bytes > lvl->arenaCap) {
+        free(lvl->arena);
+        lvl->arena = malloc(bytes);
+        lvl->arenaCap = lvl->arena ? bytes : 0;
+        if (!lvl->arena) return false;
+    }
+    uint64_t *layer = lvl->arena;
+    lvl->w = w; lvl->h = h; lvl->words = words;
+    lvl->walls = layer;
+    lvl->targets = layer + words;
+    lvl->dead = layer + 2 * words;
+    lvl->boxes = layer + 3 * words;
+    lvl->scratch = layer + 4 * words;
+    lvl->rowStart = layer + 7 * words;
+    memset(lvl->rowStart, 0, words * sizeof(uint64_t));
+    for (int y = 0; y < h; y++) BB_SET(lvl->rowStart, y * w);
+    lvl->pullDist = (unsigned short *)(layer + 8 * words);
+    lvl->queue = lvl->pullDist + cells;
+    return true;
+}
+
+// Clear lvl for a new level, keeping its arena and history buffers
+static void LevelReset(Level *lvl) {
+    MoveLog log = lvl->log;
+    void *arena = lvl->arena;
+    size_t arenaCap = lvl->arenaCap;
+    memset(lvl, 0, sizeof(Level));
+    lvl->log = log;
+    lvl->log.count = lvl->log.pos = lvl->log.snapCount = 0;
+    lvl->arena = arena;
+    lvl->arenaCap = arenaCap;
+}
+
+// Counters, hash and the first history snapshot of a freshly loaded board
+static void LevelDerive(Level *lvl) {
+    LevelRecount(lvl, &lvl->boxesOff, &lvl->boxesOn, &lvl->hash);
+    MoveLogSnapshot(lvl);
+}
+
+// Init level from nrows rows of XSB text. Rows may differ in length; '-' and
+// '_' are accepted as floor. Nothing is cropped: an oversized level is rejected.
+// lvl must be zeroed or previously loaded; its arena and history buffers are
+// reused, so a reload (R key) costs O(board size) and allocates nothing.
+LevelStatus LoadLevelRows(Level *lvl, const char **src, int rows) {
+    LevelReset(lvl);
+
+    int len = 0;
+    for (int r = 0; r < rows; r++) {
+        int n = RowLength(src[r]);
+        if (n > len) len = n;
+    }
+    if (rows == 0 || len == 0) return LEVEL_EMPTY;
+    if (rows > MAX_H || len > MAX_W) return LEVEL_TOO_BIG;
+    if (!LevelArena(lvl, len, rows)) return LEVEL_NO_MEMORY;
+    memset(lvl->arena, 0, (size_t)lvl->words * 7 * sizeof(uint64_t));
+
+    int players = 0, boxes = 0, targets = 0;
+    for (int r=0; r<rows; r++) {
+        int n = RowLength(src[r]);
+        for (int x=0; x<n; x++) {
+            int c = r * len + x;
+            switch (src[r][x]) {
+                case '#': BB_SET(lvl->walls, c); break;
+                case '.': BB_SET(lvl->targets, c); targets++; break;
+                case '$': BB_SET(lvl->boxes, c); boxes++; break;
+                case '@': lvl->px = x; lvl->py = r; players++; break;
+                case '*': BB_SET(lvl->boxes, c); BB_SET(lvl->targets, c); boxes++; targets++; break;
+                case '+': BB_SET(lvl->targets, c); lvl->px = x; lvl->py = r; players++; targets++; break;
+                case ' ': case '-': case '_': case '\t': break;
+                default : return LEVEL_BAD_CHAR;
+            }
+        }
+    }
+    if (players == 0) return LEVEL_NO_PLAYER;
+    if (players > 1) return LEVEL_MANY_PLAYERS;
+    if (boxes != targets) return LEVEL_BOX_TARGET_MISMATCH;
+
+    LevelDerive(lvl);
+    LevelComputeDeadSquares(lvl);
+    lvl->deadlock = LevelDeadlock(lvl);
+    return LEVEL_OK;
+}
+
+// Init level from a NULL-terminated array of rows
+LevelStatus LoadLevel(Level *lvl, const char **src) {
+    int rows = 0;
+    while (src[rows]) rows++;
+    return LoadLevelRows(lvl, src, rows);
+}
+
+// Check if level is solved: no box sits off a target
+bool LevelSolved(Level *lvl) {
+    PROF_BEGIN(PROF_LEVEL_SOLVED);
+    bool solved = lvl->boxesOff == 0;
+    PROF_END(PROF_LEVEL_SOLVED);
+    return solved;
+}
+
+// Release the heap memory a loaded level owns (arena and history)
+void LevelFree(Level *lvl) {
+    free(lvl->arena);
+    free(lvl->log.moves);
+    free(lvl->log.snaps);
+    memset(lvl, 0, sizeof(Level));
+}
+
+// Copy the board and position without history (dst must be zeroed or
+// loaded; its buffers are reused). False when out of memory.
+bool LevelCopyBoard(Level *dst, const Level *src) {
+    MoveLog log = dst->log;
+    void *arena = dst->arena;
+    size_t arenaCap = dst->arenaCap;
+    *dst = *src;
+    dst->log = log;
+    dst->log.count = dst->log.pos = dst->log.snapCount = 0;
+    dst->moveCount = 0;
+    dst->arena = arena;
+    dst->arenaCap = arenaCap;
+    if (!src->arena) return true;       // never loaded: nothing to copy
+    if (!LevelArena(dst, src->w, src->h)) return false;
+    memcpy(dst->walls, src->walls, (size_t)src->words * 4 * sizeof(uint64_t));
+    memset(dst->scratch, 0, (size_t)src->words * sizeof(uint64_t));      // held layer starts clear
+    return true;
+}
+
+// Deep copy including history (dst must be zeroed or loaded); false when out of memory
+bool LevelCopy(Level *dst, const Level *src) {
+    if (!LevelCopyBoard(dst, src)) return false;
+    dst->moveCount = src->moveCount;
+    MoveLog *d = &dst->log;
+    const MoveLog *s = &src->log;
+    size_t snapWords = (size_t)s->snapCount * (src->words + 1);
+    if (d->cap < s->count) {
+        unsigned char *moves = realloc(d->moves, (size_t)s->count);
+        if (!moves && s->count) return false;
+        d->moves = moves;
+        d->cap = s->count;
+    }
+    if (d->snapCap < snapWords) {
+        uint64_t *snaps = realloc(d->snaps, snapWords * sizeof(uint64_t));
+        if (!snaps) return false;
+        d->snaps = snaps;
+        d->snapCap = snapWords;
+    }
+    if (s->count) memcpy(d->moves, s->moves, (size_t)s->count);
+    if (snapWords) memcpy(d->snaps, s->snaps, snapWords * sizeof(uint64_t));
+    d->count = s->count;
+    d->pos = s->pos;
+    d->snapCount = s->snapCount;
+    return true;
+}
+
+// Record the current position as snapshot log.pos / MOVELOG_CHECKPOINT
+static void MoveLogSnapshot(Level *lvl) {
+    MoveLog *log = &lvl->log;
+    int stride = lvl->words + 1;
+    size_t need = (size_t)(log->snapCount + 1) * stride;
+    if (need > log->snapCap) {
+        size_t cap = log->snapCap * 2 > need ? log->snapCap * 2 : need * 8;
+        uint64_t *snaps = realloc(log->snaps, cap * sizeof(uint64_t));
+        if (!snaps) return;     // jumps then fall back to stepping from the nearest snapshot
+        log->snaps = snaps;
+        log->snapCap = cap;
+    }
+    uint64_t *snap = &log->snaps[(size_t)log->snapCount++ * stride];
+    memcpy(snap, lvl->boxes, lvl->words * sizeof(uint64_t));
+    snap[lvl->words] = (uint64_t)(uint32_t)lvl->px | (uint64_t)(uint32_t)lvl->py << 32;
+}
+
+// Apply one step in direction d to the layers only; returns the move byte,
+// or -1 when the step is blocked. TryMove, redo and LURD replay all go through here.
+static int LevelStepLayers(Level *lvl, int d) {
+    int nx = lvl->px + dirDX[d], ny = lvl->py + dirDY[d];
+
+    // Check bounds
+    if (nx < 0 || ny < 0 || nx >= lvl->w || ny >= lvl->h) return -1;
+    // Check for walls
+    int dest = ny * lvl->w + nx;
+    if (BB_TEST(lvl->walls, dest)) return -1;
+
+    // Handle box pushing
+    if (BB_TEST(lvl->boxes, dest)) {
+        int nnx = nx + dirDX[d], nny = ny + dirDY[d];
+        if (nnx < 0 || nny < 0 || nnx >= lvl->w || nny >= lvl->h) return -1;
+        int next = nny * lvl->w + nnx;
+        if (BB_TEST(lvl->walls, next) || BB_TEST(lvl->boxes, next)) return -1; // can't push
+        LevelMoveBox(lvl, dest, next);
+        LevelMovePlayer(lvl, nx, ny);
+        return d | MOVE_PUSH;
+    }
+    LevelMovePlayer(lvl, nx, ny);
+    return d;
+}
+
+// One step as the game plays it: layers plus the deadlock warning
+static int LevelStepMove(Level *lvl, int d) {
+    int m = LevelStepLayers(lvl, d);
+    // A deadlock never goes away by pushing more, only by undoing
+    if (m >= 0 && (m & MOVE_PUSH) && !lvl->deadlock)
+        lvl->deadlock = PushDeadlock(lvl, (lvl->py + dirDY[d]) * lvl->w + lvl->px + dirDX[d]);
+    return m;
+}
+
+// Revert last move using the history (untimed; jumps call it in a loop)
+static void UndoStep(Level *lvl) {
+    MoveLog *log = &lvl->log;
+    if (log->pos == 0) return;
+
+    int m = log->moves[--log->pos];
+    int d = m & MOVE_DIR_MASK;
+    if (m & MOVE_PUSH) {
+        // The pushed box sits one step ahead of the player: pull it back
+        int c = lvl->py * lvl->w + lvl->px;
+        LevelMoveBox(lvl, (lvl->py + dirDY[d]) * lvl->w + lvl->px + dirDX[d], c);
+    }
+    LevelMovePlayer(lvl, lvl->px - dirDX[d], lvl->py - dirDY[d]);
+    if ((m & MOVE_PUSH) && lvl->deadlock) lvl->deadlock = LevelDeadlock(lvl);
+
+    lvl->moveCount = log->pos;
+}
+
+void UndoMove(Level *lvl) {
+    PROF_BEGIN(PROF_UNDO_MOVE);
+    UndoStep(lvl);
+    PROF_END(PROF_UNDO_MOVE);
+}
+
+// Re-apply the next undone move; false when there is nothing to redo
+bool RedoMove(Level *lvl) {
+    MoveLog *log = &lvl->log;
+    if (log->pos == log->count) return false;
+    if (LevelStepMove(lvl, log->moves[log->pos] & MOVE_DIR_MASK) < 0) return false;
+    log->pos++;
+    lvl->moveCount = log->pos;
+    return true;
+}
+
+// Go to the position after `target` moves of the recorded history
+void JumpToMove(Level *lvl, int target) {
+    MoveLog *log = &lvl->log;
+    if (target < 0) target = 0;
+    if (target > log->count) target = log->count;
+
+    int k = target / MOVELOG_CHECKPOINT;
+    if (k >= log->snapCount) k = log->snapCount - 1;
+    int fromSnap = k >= 0 ? target - k * MOVELOG_CHECKPOINT : INT_MAX;
+    int distance = target > log->pos ? target - log->pos : log->pos - target;
+    if (distance > fromSnap) {
+        // Restore the nearest snapshot at or before target, then replay
+        const uint64_t *snap = &log->snaps[(size_t)k * (lvl->words + 1)];
+        memcpy(lvl->boxes, snap, lvl->words * sizeof(uint64_t));
+        lvl->px = (int)(uint32_t)snap[lvl->words];
+        lvl->py = (int)(snap[lvl->words] >> 32);
+        LevelRecount(lvl, &lvl->boxesOff, &lvl->boxesOn, &lvl->hash);
+        log->pos = k * MOVELOG_CHECKPOINT;
+        lvl->deadlock = LevelDeadlock(lvl);
+    }
+    while (log->pos > target) UndoStep(lvl);
+    while (log->pos < target && RedoMove(lvl)) {}
+    lvl->moveCount = log->pos;
+}
+
+// Try to move player (dx, dy must be one of the four unit steps)
+static void TryMoveStep(Level *lvl, int dx, int dy) {
+    int d;
+    if (dx == 0 && dy == -1) d = 0;
+    else if (dx == 0 && dy == 1) d = 1;
+    else if (dx == -1 && dy == 0) d = 2;
+    else if (dx == 1 && dy == 0) d = 3;
+    else return;
+
+    MoveLog *log = &lvl->log;
+    // Same move as the next redo entry: just walk forward and keep the tail
+    if (log->pos < log->count && (log->moves[log->pos] & MOVE_DIR_MASK) == d) {
+        RedoMove(lvl);
+        return;
+    }
+    if (log->pos == log->cap) {
+        int cap = log->cap ? log->cap * 2 : 256;
+        unsigned char *moves = realloc(log->moves, (size_t)cap);
+        if (!moves) return;     // never drop history silently: refuse the move instead
+        log->moves = moves;
+        log->cap = cap;
+    }
+
+    int m = LevelStepMove(lvl, d);
+    if (m < 0) return;
+
+    // A new move discards the redo tail and any snapshots taken along it
+    log->moves[log->pos++] = (unsigned char)m;
+    log->count = log->pos;
+    int keep = (log->pos - 1) / MOVELOG_CHECKPOINT + 1;   // snapshots of positions before this move
+    if (log->snapCount > keep) log->snapCount = keep;
+    if (log->pos % MOVELOG_CHECKPOINT == 0 && log->snapCount == log->pos / MOVELOG_CHECKPOINT) MoveLogSnapshot(lvl);
+    lvl->moveCount = log->pos;
+}
+
+void TryMove(Level *lvl, int dx, int dy) {
+    PROF_BEGIN(PROF_TRY_MOVE);
+    TryMoveStep(lvl, dx, dy);
+    PROF_END(PROF_TRY_MOVE);
+}
+
+// =================== [ LURD move strings ] ===================
+// Standard solution notation: one letter per step, u/d/l/r for walks and
+// U/D/L/R for pushes. A decimal count may prefix a letter ("3r" = "rrr") and
+// whitespace is ignored, so run-length encoded and wrapped solutions replay too.
+
+static const char lurdChars[4] = { 'u', 'd', 'l', 'r' };   // indexed like dirDX/dirDY
+
+// Letter for a move byte (dir | MOVE_PUSH)
+static char LurdChar(int m) {
+    char c = lurdChars[m & MOVE_DIR_MASK];
+    return (m & MOVE_PUSH) ? (char)(c - 'a' + 'A') : c;
+}
+
+// Move byte for a LURD letter, -1 for anything else
+static int LurdMove(int ch) {
+    switch (ch) {
+        case 'u': return 0; case 'd': return 1; case 'l': return 2; case 'r': return 3;
+        case 'U': return 0 | MOVE_PUSH; case 'D': return 1 | MOVE_PUSH;
+        case 'L': return 2 | MOVE_PUSH; case 'R': return 3 | MOVE_PUSH;
+        default: return -1;
+    }
+}
+
+// Encode count move bytes as a NUL-terminated string; needs count + 1 bytes.
+// Returns the string length, or -1 when out is too small.
+int LurdEncode(const unsigned char *moves, int count, char *out, size_t cap) {
+    if (cap < (size_t)count + 1) return -1;
+    for (int i = 0; i < count; i++) out[i] = LurdChar(moves[i]);
+    out[count] = 0;
+    return count;
+}
+
+// Decode a LURD string into move bytes; returns the number of moves, or -1
+// when out is full, on a character that is not LURD, or on a run count that is
+// zero or has no letter after it (the offset of the character or count goes
+// to *badAt).
+int LurdDecode(const char *lurd, size_t len, unsigned char *out, int cap, size_t *badAt) {
+    int n = 0;
+    long run = 0;
+    size_t runAt = SIZE_MAX;            // offset of the pending count's first digit
+    for (size_t i = 0; i < len; i++) {
+        char ch = lurd[i];
+        if (ch >= '0' && ch <= '9') {
+            if (runAt == SIZE_MAX) runAt = i;
+            run = run * 10 + (ch - '0');
+            if (run > INT_MAX) run = INT_MAX;
+            continue;
+        }
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') continue;
+        int m = LurdMove(ch);
+        if (m < 0 || (runAt != SIZE_MAX && run == 0)) { if (badAt) *badAt = m < 0 ? i : runAt; return -1; }
+        for (long k = runAt != SIZE_MAX ? run : 1; k > 0; k--) {
+            if (n == cap) { if (badAt) *badAt = i; return -1; }
+            out[n++] = (unsigned char)m;
+        }
+        run = 0;
+        runAt = SIZE_MAX;
+    }
+    if (runAt != SIZE_MAX) { if (badAt) *badAt = runAt; return -1; }
+    return n;
+}
+
+const char *ReplayStatusText(ReplayStatus st) {
+    switch (st) {
+        case REPLAY_SOLVED: return "solved";
+        case REPLAY_UNSOLVED: return "unsolved";
+        case REPLAY_ILLEGAL: return "illegal";
+        case REPLAY_BAD_CHAR: return "bad-char";
+    }
+    return "?";
+}
+
+// Replay a LURD string on lvl through the game's own step logic, stopping at
+// the first illegal move. Lowercase letters must walk and uppercase letters
+// must push. The level's history and deadlock flag are left untouched, so
+// callers replay on a scratch copy of a freshly loaded level.
+ReplayStatus ReplayLurd(Level *lvl, const char *lurd, size_t len, ReplayResult *res) {
+    memset(res, 0, sizeof(*res));
+    long run = 0;
+    bool counted = false;               // digits seen since the last letter
+    for (size_t i = 0; i < len; i++) {
+        char ch = lurd[i];
+        if (ch >= '0' && ch <= '9') {
+            counted = true;
+            run = run * 10 + (ch - '0');
+            if (run > INT_MAX) run = INT_MAX;
+            continue;
+        }
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') continue;
+        int want = LurdMove(ch);
+        // Like LurdDecode: a count must be non-zero and followed by a letter
+        if (want < 0 || (counted && run == 0)) return res->status = REPLAY_BAD_CHAR;
+        for (long k = counted ? run : 1; k > 0; k--) {
+            int d = want & MOVE_DIR_MASK;
+            // A walk letter may not push: check before stepping so the board is left as it was
+            int nx = lvl->px + dirDX[d], ny = lvl->py + dirDY[d];
+            bool pushes = nx >= 0 && ny >= 0 && nx < lvl->w && ny < lvl->h && BB_TEST(lvl->boxes, ny * lvl->w + nx);
+            int m = pushes == ((want & MOVE_PUSH) != 0) ? LevelStepLayers(lvl, d) : -1;
+            if (m < 0) {
+                res->firstIllegal = res->moves + 1;
+                return res->status = REPLAY_ILLEGAL;
+            }
+            res->moves++;
+            res->pushes += pushes;
+        }
+        run = 0;
+        counted = false;
+    }
+    if (counted) return res->status = REPLAY_BAD_CHAR;
+    return res->status = LevelSolved(lvl) ? REPLAY_SOLVED : REPLAY_UNSOLVED;
+}
+// ========================================================================
+
+// =================== [ Level packs (XSB / .sok) ] ===================
+// Streaming reader for multi-level text packs. Only the current level's rows
+// are held in memory, so packs with thousands of levels are read line by line.
+// A level is a run of board lines; anything else separates levels. Lines
+// starting with ';' are comments, "Key: value" lines are metadata and the
+// level's title comes from "Title:" (or the last comment before the board).
+
+int PackOpen(PackReader *pr, const char *path) {
+    memset(pr, 0, sizeof(*pr));
+    pr->f = fopen(path, "rb");
+    return pr->f != NULL;
+}
+
+void PackClose(PackReader *pr) {
+    if (pr->f) fclose(pr->f);
+    for (int i = 0; i < pr->rowCap; i++) free(pr->rows[i]);
+    free(pr->rows);
+    free(pr->line);
+    memset(pr, 0, sizeof(*pr));
+}
+
+// Read one line of any length into pr->line; 0 at end of file
+static int PackReadLine(PackReader *pr) {
+    size_t len = 0;
+    for (;;) {
+        if (pr->lineCap - len < 2) {
+            size_t cap = pr->lineCap ? pr->lineCap * 2 : 256;
+            char *line = realloc(pr->line, cap);
+            if (!line) return 0;
+            pr->line = line;
+            pr->lineCap = cap;
+        }
+        if (!fgets(pr->line + len, (int)(pr->lineCap - len), pr->f)) {
+            if (len == 0) return 0;
+            break;
+        }
+        len += strlen(pr->line + len);
+        if (len > 0 && pr->line[len-1] == '\n') break;
+    }
+    pr->lineNo++;
+    return 1;
+}
+
+// A board line holds only level characters and at least one wall
+static int IsBoardLine(const char *s) {
+    int walls = 0;
+    for (; *s && *s != '\n' && *s != '\r'; s++) {
+        if (*s == '#') walls++;
+        else if (!strchr(" \t-_.$*@+", *s)) return 0;
+    }
+    return walls > 0;
+}
+
+static void CopyTrimmed(char *dst, size_t cap, const char *src) {
+    while (*src == ' ' || *src == '\t') src++;
+    size_t n = strlen(src);
+    while (n > 0 && (src[n-1] == '\n' || src[n-1] == '\r' || src[n-1] == ' ')) n--;
+    if (n >= cap) n = cap - 1;
+    memcpy(dst, src, n);
+    dst[n] = 0;
+}
+
+static int PackKeepRow(PackReader *pr) {
+    if (pr->rowCount == PACK_MAX_ROWS) return 1;   // overflow rows are dropped; the level will be TOO_BIG
+    if (pr->rowCount == pr->rowCap) {
+        int cap = pr->rowCap ? pr->rowCap * 2 : 32;
+        char **rows = realloc(pr->rows, (size_t)cap * sizeof(char *));
+        if (!rows) return 0;
+        for (int i = pr->rowCap; i < cap; i++) rows[i] = NULL;
+        pr->rows = rows;
+        pr->rowCap = cap;
+    }
+    size_t n = strlen(pr->line) + 1;
+    char *row = realloc(pr->rows[pr->rowCount], n);
+    if (!row) return 0;
+    memcpy(row, pr->line, n);
+    pr->rows[pr->rowCount++] = row;
+    return 1;
+}
+
+static void PackNoteMeta(PackReader *pr, char *title) {
+    if (strncmp(pr->line, "Title:", 6) == 0) CopyTrimmed(title, sizeof(pr->title), pr->line + 6);
+    else if (pr->line[0] == ';') CopyTrimmed(pr->comment, sizeof(pr->comment), pr->line + 1);
+}
+
+// Read the next level into lvl. Returns 1 and sets *status when a level was
+// found (status may be an error for malformed levels), 0 at end of pack.
+int PackNext(PackReader *pr, Level *lvl, LevelStatus *status) {
+    pr->rowCount = 0;
+
+    // Skip to the first board line; comments there name the coming level
+    while (!pr->haveLine) {
+        if (!PackReadLine(pr)) return 0;
+        if (IsBoardLine(pr->line)) pr->haveLine = 1;
+        else PackNoteMeta(pr, pr->comment);
+    }
+    pr->firstLine = pr->lineNo;
+    snprintf(pr->title, sizeof(pr->title), "%s", pr->comment);
+    pr->comment[0] = 0;
+
+    // Board rows
+    int more = 1;
+    while (pr->haveLine) {
+        if (!PackKeepRow(pr)) return 0;
+        more = PackReadLine(pr);
+        pr->haveLine = more && IsBoardLine(pr->line);
+    }
+    // Metadata after the board, up to the next board; "Title:" names this
+    // level. Comments right below the board are notes on it: only those after
+    // a blank line may name the next level.
+    bool gap = false;
+    while (more && !pr->haveLine) {
+        const char *c = pr->line;
+        while (*c == ' ' || *c == '\t') c++;
+        if (*c == 0 || *c == '\n' || *c == '\r') gap = true;
+        else if (gap || pr->line[0] != ';') PackNoteMeta(pr, pr->title);
+        more = PackReadLine(pr);
+        pr->haveLine = more && IsBoardLine(pr->line);
+    }
+
+    pr->index++;
+    *status = LoadLevelRows(lvl, (const char **)pr->rows, pr->rowCount);
+    return 1;
+}
+// ========================================================================
+
+// =================== [ Auto-solver (headless) ] ===================
+// Push-optimal A* over a compact state: the sorted list of box cells plus the
+// normalized player cell (lowest-index square the player can walk to). Nodes
+// never copy Level; the whole search lives in a few flat arrays so it can run
+// from the S key, from the command line (--solve) or in a batch.
+
+#define SOLVER_MAX_BOXES 64
+#define SOLVER_INF PULL_INF
+#define SOLVER_STATE_MAX 160        // bytes of an encoded box list, see SolverEncode
+#define SOLVER_CHUNK_BITS 12        // nodes in the first storage chunk (log2); each next one doubles
+
+// Per-cell tables are sized to the board (see SolverInit)
+typedef struct {
+    int w, h, cells, nboxes, ntargets;
+    unsigned char *wall;
+    unsigned char *target;
+    unsigned short *pushDist;  // pushes to nearest target, SOLVER_INF = dead
+    Heuristic heuristic;
+    unsigned short *boxCost;   // NEAREST, MANHATTAN: estimate per box cell
+    unsigned short *targetDist; // GREEDY, MATCHING: pushes from cell c to target t at [c * ntargets + t]
+    unsigned short *floorIndex; // rank of each non-wall cell, for the state encoding
+    unsigned short *floorCell;  // and back
+    int floors, riceBits, stateBytes;
+    uint64_t *zobBox;
+    uint64_t *zobPlayer;
+    unsigned short startBoxes[SOLVER_MAX_BOXES];
+    int startPlayer;
+} SolverBoard;
+
+// Nodes are stored nodeStride bytes apart: this header, then the box list
+// as b.stateBytes of SolverEncode output. The hash is not kept; it is
+// recomputed from the boxes when the table grows.
+typedef struct {
+    int parent;
+    unsigned short player;   // normalized player cell
+    unsigned short g;        // pushes from the root
+    unsigned short pushFrom; // box cell before the push that created this node
+    unsigned char pushDir;
+    unsigned char state[];
+} SolverNode;
+
+// Solver table memory, see SolverBlockAlloc
+typedef struct {
+    void *p;
+    size_t bytes;
+    bool mapped;
+} SolverBlock;
+
+typedef struct { unsigned int f, g; int node; } SolverHeapItem;
+
+// One successor produced by SolverExpand
+typedef struct {
+    uint64_t hash;
+    unsigned int h;
+    unsigned short player, pushFrom;
+    unsigned char pushDir;
+    unsigned short boxes[SOLVER_MAX_BOXES];
+    unsigned char state[SOLVER_STATE_MAX];
+} SolverChild;
+
+// Positions solved or proven dead by earlier searches of the same board,
+// keyed by node hash (boxes + normalized player). The hint engine keeps it
+// between queries, so a search stops at any position already solved and
+// never enters one already proven dead.
+#define SOLVER_MEMO_MAX (1u << 21)      // entries (32 MB)
+
+typedef struct {
+    uint64_t hash;              // 0 = empty slot
+    unsigned int pushes;        // pushes left on an optimal solution
+    unsigned short box;         // first push of that solution: box cell and direction
+    unsigned char dir;
+    unsigned char dead;         // no solution from here
+} SolverMemoEntry;
+
+typedef struct {
+    SolverMemoEntry *entries;
+    unsigned int mask;
+    int count;
+} SolverMemo;
+
+typedef enum { SEARCH_RUNNING, SEARCH_GOAL, SEARCH_EXHAUSTED, SEARCH_FAILED } SearchState;
+
+// Min-cost assignment of boxes (rows) to targets (columns) with the dual
+// potentials u, v of the Hungarian method. Indices are 1-based; p[col] is the
+// row matched to col, and rows past nboxes are free padding.
+typedef struct {
+    int n;
+    int u[SOLVER_MAX_BOXES + 1], v[SOLVER_MAX_BOXES + 1], p[SOLVER_MAX_BOXES + 1];
+    unsigned short cell[SOLVER_MAX_BOXES + 1];
+} SolverMatching;
+
+#define SOLVER_H_DEAD UINT_MAX   // estimate of a position no assignment can solve
+
+// A lower bound: estimate() rates a whole position and remembers it;
+// moved() rates that position with its box i pushed to dest (after = the new
+// sorted box list), reusing what estimate() worked out
+typedef struct Solver Solver;
+typedef struct {
+    const char *name;
+    unsigned int (*estimate)(Solver *s, const unsigned short *boxes);
+    unsigned int (*moved)(Solver *s, const unsigned short *after, int i, int dest);
+} SolverHeuristicOps;
+
+struct Solver {
+    SolverBoard b;
+    Level work;              // box layer mirrors the node being expanded, for deadlock checks
+
+    SolverBlock *chunks;     // node storage, see SolverNodeAt
+    int chunkCount;
+    size_t nodeStride;
+    int nodeCount, nodeCap;
+
+    SolverBlock tableBlock;
+    int *table;              // node index + 1, 0 = empty
+    unsigned int tableMask;
+
+    SolverBlock heapBlock;
+    SolverHeapItem *heap;
+    int heapCount, heapCap;
+
+    // Tables stay in RAM up to memBudget bytes (0 = no limit); past it new
+    // blocks are mapped from temporary files in spillDir (NULL = TMPDIR)
+    size_t memBudget;
+    const char *spillDir;
+    size_t ramBytes, spillBytes, peakSpill;
+
+    // scratch for expansion (per cell, in cellArena with the board tables)
+    unsigned char *occ;
+    unsigned int *mark;
+    unsigned int markGen;
+    unsigned short *queue;
+    short *prev;
+    unsigned char *reach;
+    SolverChild kids[SOLVER_MAX_BOXES * 4];
+    void *cellArena;
+
+    size_t peakBytes;
+
+    // Set by SolverRun: the goal node, and for a memo hit the pushes still
+    // left from it; the node with the lowest estimate so far (anytime answer)
+    int goal;
+    unsigned int goalRest;
+    int best;
+    unsigned int bestH;
+    const SolverMemo *memo;     // optional, see SolverMemo
+
+    // Lower bound (b.heuristic) and its scratch: the position last estimated,
+    // and for MATCHING its assignment plus the child being re-matched
+    const SolverHeuristicOps *estimator;
+    void *heuristicArena;       // boxCost / targetDist when not pushDist
+    const unsigned short *estBoxes;
+    unsigned int estH;
+    SolverMatching match, kidMatch;
+    int matchMinv[SOLVER_MAX_BOXES + 1], matchWay[SOLVER_MAX_BOXES + 1];
+    unsigned char matchUsed[SOLVER_MAX_BOXES + 1];
+    uint64_t greedyPairs[SOLVER_MAX_BOXES * SOLVER_MAX_BOXES];
+    int greedyCount;
+};
+
+double NowSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t SplitMix64(uint64_t *s) {
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Cell one step from c in direction d, or -1 when it leaves the board
+static int SolverStep(const SolverBoard *b, int c, int d) {
+    int x = c % b->w + dirDX[d], y = c / b->w + dirDY[d];
+    if (x < 0 || y < 0 || x >= b->w || y >= b->h) return -1;
+    return y * b->w + x;
+}
+
+// Take the start position (boxes sorted by cell, player) from lvl, which must
+// be the board b was built for. 0 without boxes, with too many or too few targets.
+static int SolverBoardStart(SolverBoard *b, const Level *lvl) {
+    b->nboxes = 0;
+    for (int i = 0; i < lvl->words; i++) {
+        for (uint64_t bits = lvl->boxes[i]; bits; bits &= bits - 1) {
+            if (b->nboxes == SOLVER_MAX_BOXES) return 0;
+            b->startBoxes[b->nboxes++] = (unsigned short)(i * 64 + BitIndex(bits));
+        }
+    }
+    if (b->nboxes == 0 || b->ntargets < b->nboxes) return 0;
+    b->startPlayer = lvl->py * lvl->w + lvl->px;
+    return 1;
+}
+
+static int SolverBoardInit(SolverBoard *b, const Level *lvl, unsigned short *queue) {
+    b->w = lvl->w; b->h = lvl->h; b->cells = lvl->w * lvl->h;
+    b->ntargets = 0;
+    b->floors = 0;
+    for (int c = 0; c < b->cells; c++) {
+        b->wall[c] = (unsigned char)BB_TEST(lvl->walls, c);
+        b->target[c] = (unsigned char)BB_TEST(lvl->targets, c);
+        b->ntargets += b->target[c];
+        if (b->wall[c]) continue;
+        b->floorIndex[c] = (unsigned short)b->floors;
+        b->floorCell[b->floors++] = (unsigned short)c;
+    }
+    if (!SolverBoardStart(b, lvl)) return 0;
+
+    // Gaps between boxes average floors / nboxes cells: Rice-code them with
+    // that many low bits. The quotients add up to at most floors >> riceBits.
+    b->riceBits = 0;
+    while ((b->floors / b->nboxes) >> (b->riceBits + 1)) b->riceBits++;
+    b->stateBytes = (b->nboxes * (b->riceBits + 1) + (b->floors >> b->riceBits) + 7) / 8;
+
+    // pushDist doubles as the heuristic and the dead-square filter
+    LevelPullDistances(lvl, b->pushDist, queue);
+
+    for (int c = 0; c < b->cells; c++) {
+        b->zobBox[c] = ZobristKey(c, 0);
+        b->zobPlayer[c] = ZobristKey(c, 1);
+    }
+    return 1;
+}
+
+// Lower bounds (Heuristic). NEAREST and MANHATTAN add up a per-cell table,
+// so a push changes one term. GREEDY pairs boxes and targets cheapest-first;
+// it can overestimate, so its solutions are not always push-optimal, but it
+// is cheap and usually tighter. MATCHING is the min-cost perfect matching
+// over push distances (Hungarian method). It solves a position once per
+// expansion; each push then frees one row and finds one augmenting path,
+// O(n^2) instead of O(n^3), and proves a position dead when no assignment
+// reaches every target.
+
+static unsigned int SumEstimate(Solver *s, const unsigned short *boxes) {
+    const SolverBoard *b = &s->b;
+    unsigned int h = 0;
+    for (int i = 0; i < b->nboxes; i++) h += b->boxCost[boxes[i]];
+    s->estBoxes = boxes;
+    s->estH = h;
+    return h;
+}
+
+static unsigned int SumMoved(Solver *s, const unsigned short *after, int i, int dest) {
+    (void)after;
+    const SolverBoard *b = &s->b;
+    return s->estH - b->boxCost[s->estBoxes[i]] + b->boxCost[dest];
+}
+
+static int CompareU64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Box-target pair: cost << 32 | box cell << 16 | box << 8 | target. Sorted,
+// pairs go by cost and then by cell, so ties break on the position alone and
+// GreedyMoved's merged list picks the same pairs a fresh sort would.
+#define GREEDY_PAIR(cost, cell, box, t) \
+    ((uint64_t)(cost) << 32 | (uint64_t)(cell) << 16 | (uint64_t)(box) << 8 | (uint64_t)(t))
+
+// Take pairs cheapest-first from the merge of the sorted lists a (minus box
+// `skip`'s pairs) and b until every box has a target. *done gets the boxes
+// that found one.
+static unsigned int GreedyTake(const uint64_t *a, int na, int skip, const uint64_t *b, int nbPairs,
+                               int boxes, uint64_t *done) {
+    uint64_t boxDone = 0, targetDone = 0;
+    unsigned int h = 0;
+    for (int ka = 0, kb = 0, left = boxes; left > 0 && (ka < na || kb < nbPairs);) {
+        uint64_t x;
+        if (ka < na && (int)(a[ka] >> 8 & 0xFF) == skip) { ka++; continue; }
+        if (kb == nbPairs || (ka < na && a[ka] < b[kb])) x = a[ka++];
+        else x = b[kb++];
+        int i = (int)(x >> 8 & 0xFF), t = (int)(x & 0xFF);
+        if ((boxDone >> i & 1) || (targetDone >> t & 1)) continue;
+        boxDone |= 1ULL << i;
+        targetDone |= 1ULL << t;
+        h += (unsigned int)(x >> 32);
+        left--;
+    }
+    *done = boxDone;
+    return h;
+}
+
+// Sorts every pair once per expansion; each child then only re-sorts the
+// moved box's pairs and merges them in
+static unsigned int GreedyEstimate(Solver *s, const unsigned short *boxes) {
+    const SolverBoard *b = &s->b;
+    int nb = b->nboxes, nt = b->ntargets, n = 0;
+    for (int i = 0; i < nb; i++) {
+        const unsigned short *d = &b->targetDist[(size_t)boxes[i] * nt];
+        for (int t = 0; t < nt; t++)
+            if (d[t] != SOLVER_INF) s->greedyPairs[n++] = GREEDY_PAIR(d[t], boxes[i], i, t);
+    }
+    qsort(s->greedyPairs, (size_t)n, sizeof(uint64_t), CompareU64);
+    s->greedyCount = n;
+    s->estBoxes = boxes;
+    uint64_t done;
+    unsigned int h = GreedyTake(s->greedyPairs, n, -1, NULL, 0, nb, &done);
+    // Boxes left without a reachable free target count their nearest one
+    for (int i = 0; i < nb; i++) if (!(done >> i & 1)) h += b->pushDist[boxes[i]];
+    return h;
+}
+
+static unsigned int GreedyMoved(Solver *s, const unsigned short *after, int i, int dest) {
+    (void)after;
+    const SolverBoard *b = &s->b;
+    int nb = b->nboxes, nt = b->ntargets, n = 0;
+    uint64_t moved[SOLVER_MAX_BOXES];
+    const unsigned short *d = &b->targetDist[(size_t)dest * nt];
+    for (int t = 0; t < nt; t++) {
+        if (d[t] == SOLVER_INF) continue;
+        uint64_t x = GREEDY_PAIR(d[t], dest, i, t);
+        int k = n++;
+        for (; k > 0 && moved[k - 1] > x; k--) moved[k] = moved[k - 1];
+        moved[k] = x;
+    }
+    uint64_t done;
+    unsigned int h = GreedyTake(s->greedyPairs, s->greedyCount, i, moved, n, nb, &done);
+    for (int j = 0; j < nb; j++) if (!(done >> j & 1)) h += b->pushDist[j == i ? dest : s->estBoxes[j]];
+    return h;
+}
+
+#define MATCH_BIG (1 << 24)     // cost of an unreachable pair; above any real total
+
+static int MatchCost(const SolverBoard *b, const SolverMatching *m, int row, int col) {
+    if (row > b->nboxes) return 0;
+    unsigned short d = b->targetDist[(size_t)m->cell[row] * b->ntargets + col - 1];
+    return d == SOLVER_INF ? MATCH_BIG : d;
+}
+
+// Match the free row `row` along a shortest augmenting path. The potentials
+// must be feasible (u[i] + v[j] <= cost) and tight on every matched pair.
+static void MatchAugment(Solver *s, SolverMatching *m, int row) {
+    const SolverBoard *b = &s->b;
+    int n = m->n, *minv = s->matchMinv, *way = s->matchWay;
+    unsigned char *used = s->matchUsed;
+    for (int j = 0; j <= n; j++) { minv[j] = INT_MAX; used[j] = 0; }
+    m->p[0] = row;
+    int j0 = 0;
+    do {
+        used[j0] = 1;
+        int i0 = m->p[j0], delta = INT_MAX, j1 = 0;
+        for (int j = 1; j <= n; j++) {
+            if (used[j]) continue;
+            int cur = MatchCost(b, m, i0, j) - m->u[i0] - m->v[j];
+            if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+            if (minv[j] < delta) { delta = minv[j]; j1 = j; }
+        }
+        for (int j = 0; j <= n; j++) {
+            if (used[j]) { m->u[m->p[j]] += delta; m->v[j] -= delta; }
+            else minv[j] -= delta;
+        }
+        j0 = j1;
+    } while (m->p[j0] != 0);
+    do {
+        int j1 = way[j0];
+        m->p[j0] = m->p[j1];
+        j0 = j1;
+    } while (j0);
+}
+
+static unsigned int MatchTotal(const SolverBoard *b, const SolverMatching *m) {
+    unsigned int h = 0;
+    for (int j = 1; j <= m->n; j++) {
+        int c = MatchCost(b, m, m->p[j], j);
+        if (c == MATCH_BIG) return SOLVER_H_DEAD;
+        h += (unsigned int)c;
+    }
+    return h;
+}
+
+static unsigned int MatchEstimate(Solver *s, const unsigned short *boxes) {
+    const SolverBoard *b = &s->b;
+    SolverMatching *m = &s->match;
+    m->n = b->ntargets;
+    memset(m->u, 0, sizeof(m->u));
+    memset(m->v, 0, sizeof(m->v));
+    memset(m->p, 0, sizeof(m->p));
+    for (int i = 0; i < b->nboxes; i++) m->cell[i + 1] = boxes[i];
+    for (int row = 1; row <= m->n; row++) MatchAugment(s, m, row);
+    return MatchTotal(b, m);
+}
+
+static unsigned int MatchMoved(Solver *s, const unsigned short *after, int i, int dest) {
+    (void)after;
+    const SolverBoard *b = &s->b;
+    SolverMatching *m = &s->kidMatch;
+    *m = s->match;
+    int row = i + 1, u = INT_MAX;
+    for (int j = 1; j <= m->n; j++) if (m->p[j] == row) { m->p[j] = 0; break; }
+    m->cell[row] = (unsigned short)dest;
+    // Lower the row's potential until no pair of the moved box is overpriced
+    for (int j = 1; j <= m->n; j++) {
+        int c = MatchCost(b, m, row, j) - m->v[j];
+        if (c < u) u = c;
+    }
+    m->u[row] = u;
+    MatchAugment(s, m, row);
+    return MatchTotal(b, m);
+}
+
+static const SolverHeuristicOps solverHeuristics[HEURISTIC_COUNT] = {
+    [HEURISTIC_NEAREST]   = { "nearest", SumEstimate, SumMoved },
+    [HEURISTIC_MANHATTAN] = { "manhattan", SumEstimate, SumMoved },
+    [HEURISTIC_GREEDY]    = { "greedy", GreedyEstimate, GreedyMoved },
+    [HEURISTIC_MATCHING]  = { "matching", MatchEstimate, MatchMoved },
+};
+
+const char *HeuristicName(Heuristic h) {
+    return h >= 0 && h < HEURISTIC_COUNT ? solverHeuristics[h].name : "?";
+}
+
+// HEURISTIC_COUNT when name is not one of HeuristicName's
+Heuristic HeuristicParse(const char *name) {
+    for (int h = 0; h < HEURISTIC_COUNT; h++)
+        if (strcmp(name, solverHeuristics[h].name) == 0) return (Heuristic)h;
+    return HEURISTIC_COUNT;
+}
+
+// Build the tables b->heuristic needs. Matchings fall back to NEAREST beyond
+// SOLVER_MAX_BOXES targets.
+static int SolverHeuristicInit(Solver *s, const Level *lvl) {
+    SolverBoard *b = &s->b;
+    bool pairs = b->heuristic == HEURISTIC_GREEDY || b->heuristic == HEURISTIC_MATCHING;
+    if (b->heuristic < 0 || b->heuristic >= HEURISTIC_COUNT || (pairs && b->ntargets > SOLVER_MAX_BOXES))
+        b->heuristic = HEURISTIC_NEAREST;
+    s->estimator = &solverHeuristics[b->heuristic];
+    b->boxCost = b->pushDist;
+    if (b->heuristic == HEURISTIC_NEAREST) return 1;
+
+    int nt = b->ntargets, targets[SOLVER_MAX_BOXES], count = 0;
+    size_t cells = (size_t)b->cells;
+    // MANHATTAN: one table; matchings: one column per target plus a scratch row
+    unsigned short *arena = malloc((b->heuristic == HEURISTIC_MANHATTAN ? 1 : (size_t)nt + 1) * cells * sizeof(unsigned short));
+    if (!arena) return 0;
+    s->heuristicArena = arena;
+    if (b->heuristic == HEURISTIC_MANHATTAN) {
+        // Targets are listed in the BFS queue, which is free until the search starts
+        unsigned short *list = s->queue;
+        int listed = 0;
+        for (int c = 0; c < b->cells; c++) if (b->target[c]) list[listed++] = (unsigned short)c;
+        for (size_t c = 0; c < cells; c++) {
+            int best = SOLVER_INF, x = (int)(c % b->w), y = (int)(c / b->w);
+            for (int k = 0; k < listed; k++) {
+                int d = abs(x - list[k] % b->w) + abs(y - list[k] / b->w);
+                if (d < best) best = d;
+            }
+            arena[c] = (unsigned short)best;
+        }
+        b->boxCost = arena;
+        return 1;
+    }
+    for (int c = 0; c < b->cells && count < nt; c++) if (b->target[c]) targets[count++] = c;
+    unsigned short *dist = arena + (size_t)nt * cells;
+    for (int t = 0; t < nt; t++) {
+        LevelPullDistancesTo(lvl, targets[t], dist, s->queue);
+        for (size_t c = 0; c < cells; c++) arena[c * nt + t] = dist[c];
+    }
+    b->targetDist = arena;
+    return 1;
+}
+
+static unsigned int SolverEstimate(Solver *s, const unsigned short *boxes) {
+    return s->estimator->estimate(s, boxes);
+}
+
+// All boxes on targets
+static bool SolverBoxesHome(const SolverBoard *b, const unsigned short *boxes) {
+    for (int i = 0; i < b->nboxes; i++) if (!b->target[boxes[i]]) return false;
+    return true;
+}
+
+// Size the board tables and expansion scratch to lvl (one allocation), take a
+// private copy of its layers for deadlock checks and fill the board tables
+static int SolverInit(Solver *s, const Level *lvl) {
+    size_t cells = (size_t)lvl->w * lvl->h;
+    size_t perCell = 2 * sizeof(uint64_t) + sizeof(unsigned int) + 5 * sizeof(unsigned short) + 4;
+    s->cellArena = calloc(cells ? cells : 1, perCell);
+    if (!s->cellArena || !LevelCopyBoard(&s->work, lvl)) return 0;
+
+    SolverBoard *b = &s->b;
+    b->zobBox = s->cellArena;
+    b->zobPlayer = b->zobBox + cells;
+    s->mark = (unsigned int *)(b->zobPlayer + cells);
+    b->pushDist = (unsigned short *)(s->mark + cells);
+    s->queue = b->pushDist + cells;
+    s->prev = (short *)(s->queue + cells);
+    b->floorIndex = (unsigned short *)(s->prev + cells);
+    b->floorCell = b->floorIndex + cells;
+    b->wall = (unsigned char *)(b->floorCell + cells);
+    b->target = b->wall + cells;
+    s->occ = b->target + cells;
+    s->reach = s->occ + cells;
+    if (!SolverBoardInit(b, lvl, s->queue) || !SolverHeuristicInit(s, lvl)) return 0;
+    s->nodeStride = (offsetof(SolverNode, state) + (size_t)b->stateBytes + 3) & ~(size_t)3;
+    return 1;
+}
+
+// Box list (sorted by cell) to a delta code: per box, the floor cells skipped
+// since the previous box, Rice-coded. Equal lists give equal bytes.
+static void SolverEncode(const SolverBoard *b, const unsigned short *boxes, unsigned char *out) {
+    memset(out, 0, (size_t)b->stateBytes);
+    int k = b->riceBits, bit = 0, prev = -1;
+    for (int i = 0; i < b->nboxes; i++) {
+        int idx = b->floorIndex[boxes[i]], gap = idx - prev - 1;
+        prev = idx;
+        for (int q = gap >> k; q > 0; q--, bit++) out[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+        bit++;                                  // a 0 ends the quotient
+        for (int j = 0; j < k; j++, bit++)
+            if (gap >> j & 1) out[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+    }
+}
+
+static void SolverDecode(const SolverBoard *b, const unsigned char *in, unsigned short *boxes) {
+    int k = b->riceBits, bit = 0, prev = -1;
+    for (int i = 0; i < b->nboxes; i++) {
+        int gap = 0;
+        for (; in[bit >> 3] >> (bit & 7) & 1; bit++) gap += 1 << k;
+        bit++;
+        for (int j = 0; j < k; j++, bit++) gap |= (in[bit >> 3] >> (bit & 7) & 1) << j;
+        prev += gap + 1;
+        boxes[i] = b->floorCell[prev];
+    }
+}
+
+// Chunk c holds nodes [(2^c - 1) << SOLVER_CHUNK_BITS, (2^(c+1) - 1) << SOLVER_CHUNK_BITS)
+static SolverNode *SolverNodeAt(const Solver *s, int i) {
+    int c = BitHighest(((unsigned int)i >> SOLVER_CHUNK_BITS) + 1);
+    size_t first = (((size_t)1 << c) - 1) << SOLVER_CHUNK_BITS;
+    return (SolverNode *)((unsigned char *)s->chunks[c].p + ((size_t)i - first) * s->nodeStride);
+}
+
+// Zobrist hash of node i; its boxes are decoded into `boxes`
+static uint64_t SolverNodeHash(const Solver *s, int i, unsigned short *boxes) {
+    const SolverBoard *b = &s->b;
+    const SolverNode *n = SolverNodeAt(s, i);
+    SolverDecode(b, n->state, boxes);
+    uint64_t hash = b->zobPlayer[n->player];
+    for (int j = 0; j < b->nboxes; j++) hash ^= b->zobBox[boxes[j]];
+    return hash;
+}
+
+// Map `bytes` of a new temporary file read-write; the file is removed as
+// soon as it is mapped, so nothing is left behind. NULL on failure.
+static void *SpillMap(const char *dir, size_t bytes) {
+#if defined(_WIN32)
+    char tmp[MAX_PATH], path[MAX_PATH];
+    if (!dir && GetTempPathA(sizeof(tmp), tmp)) dir = tmp;
+    if (!dir || !GetTempFileNameA(dir, "sok", 0, path)) return NULL;
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    HANDLE map = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, NULL);
+    CloseHandle(file);
+    if (!map) return NULL;
+    void *p = MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    CloseHandle(map);       // the view keeps the mapping alive
+    return p;
+#else
+    char path[512];
+    if (!dir) dir = getenv("TMPDIR");
+    snprintf(path, sizeof(path), "%s/sokoban-spill-XXXXXX", dir && *dir ? dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    unlink(path);
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, (off_t)bytes) == 0) p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : p;
+#endif
+}
+
+// Zeroed memory for solver tables. It comes from RAM while the tables fit in
+// s->memBudget, and past it from a mapped temporary file: the kernel can then
+// write cold nodes out to disk instead of the search running out of memory.
+static bool SolverBlockAlloc(Solver *s, SolverBlock *blk, size_t bytes) {
+    blk->bytes = bytes;
+    blk->mapped = s->memBudget && s->ramBytes + bytes > s->memBudget;
+    blk->p = blk->mapped ? SpillMap(s->spillDir, bytes) : calloc(1, bytes);
+    if (!blk->p) return false;
+    if (blk->mapped) s->spillBytes += bytes;
+    else s->ramBytes += bytes;
+    if (s->spillBytes > s->peakSpill) s->peakSpill = s->spillBytes;
+    if (s->ramBytes + s->spillBytes > s->peakBytes) s->peakBytes = s->ramBytes + s->spillBytes;
+    return true;
+}
+
+static void SolverBlockFree(Solver *s, SolverBlock *blk) {
+    if (!blk->p) return;
+    if (!blk->mapped) {
+        free(blk->p);
+        s->ramBytes -= blk->bytes;
+    } else {
+#if defined(_WIN32)
+        UnmapViewOfFile(blk->p);
+#else
+        munmap(blk->p, blk->bytes);
+#endif
+        s->spillBytes -= blk->bytes;
+    }
+    blk->p = NULL;
+}
+
+
+// Flood the player region from cell `from` with the boxes in s->occ.
+// Marks reachable cells with the current generation and returns the lowest one.
+static int SolverReach(Solver *s, int from) {
+    const SolverBoard *b = &s->b;
+    unsigned int gen = ++s->markGen;
+    int qh = 0, qt = 0, lowest = from;
+    s->queue[qt++] = (unsigned short)from;
+    s->mark[from] = gen;
+    while (qh < qt) {
+        int c = s->queue[qh++];
+        if (c < lowest) lowest = c;
+        for (int d = 0; d < 4; d++) {
+            int n = SolverStep(b, c, d);
+            if (n < 0 || b->wall[n] || s->occ[n] || s->mark[n] == gen) continue;
+            s->mark[n] = gen;
+            s->queue[qt++] = (unsigned short)n;
+        }
+    }
+    return lowest;
+}
+
+// Add a chunk twice the size of the last; stored nodes never move
+static int SolverGrow(Solver *s) {
+    long long nodes = 1LL << (SOLVER_CHUNK_BITS + s->chunkCount);
+    if (s->nodeCap + nodes > INT_MAX) return 0;
+    SolverBlock *chunks = realloc(s->chunks, (size_t)(s->chunkCount + 1) * sizeof(SolverBlock));
+    if (!chunks) return 0;
+    s->chunks = chunks;
+    if (!SolverBlockAlloc(s, &s->chunks[s->chunkCount], (size_t)nodes * s->nodeStride)) return 0;
+    s->chunkCount++;
+    s->nodeCap += (int)nodes;
+    return 1;
+}
+
+static int SolverRehash(Solver *s) {
+    unsigned int size = s->tableMask ? (s->tableMask + 1) * 2 : 8192;
+    SolverBlock blk;
+    if (!size || !SolverBlockAlloc(s, &blk, (size_t)size * sizeof(int))) return 0;
+    int *table = blk.p;
+    unsigned short boxes[SOLVER_MAX_BOXES];
+    for (int i = 0; i < s->nodeCount; i++) {
+        unsigned int slot = (unsigned int)SolverNodeHash(s, i, boxes) & (size - 1);
+        while (table[slot]) slot = (slot + 1) & (size - 1);
+        table[slot] = i + 1;
+    }
+    SolverBlockFree(s, &s->tableBlock);
+    s->tableBlock = blk;
+    s->table = table;
+    s->tableMask = size - 1;
+    return 1;
+}
+
+static int SolverHeapPush(Solver *s, unsigned int f, unsigned int g, int node) {
+    if (s->heapCount == s->heapCap) {
+        int cap = s->heapCap ? s->heapCap * 2 : 4096;
+        SolverBlock blk;
+        if (cap < 0 || !SolverBlockAlloc(s, &blk, (size_t)cap * sizeof(SolverHeapItem))) return 0;
+        if (s->heapCount) memcpy(blk.p, s->heap, (size_t)s->heapCount * sizeof(SolverHeapItem));
+        SolverBlockFree(s, &s->heapBlock);
+        s->heapBlock = blk;
+        s->heap = blk.p;
+        s->heapCap = cap;
+    }
+    // Lower f first; on ties prefer the deeper node
+    int i = s->heapCount++;
+    SolverHeapItem it = { f, g, node };
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        SolverHeapItem *hp = &s->heap[p];
+        if (hp->f < f || (hp->f == f && hp->g >= g)) break;
+        s->heap[i] = *hp;
+        i = p;
+    }
+    s->heap[i] = it;
+    return 1;
+}
+
+static SolverHeapItem SolverHeapPop(Solver *s) {
+    SolverHeapItem top = s->heap[0];
+    SolverHeapItem last = s->heap[--s->heapCount];
+    int i = 0, n = s->heapCount;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && (s->heap[c+1].f < s->heap[c].f ||
+            (s->heap[c+1].f == s->heap[c].f && s->heap[c+1].g > s->heap[c].g))) c++;
+        if (last.f < s->heap[c].f || (last.f == s->heap[c].f && last.g >= s->heap[c].g)) break;
+        s->heap[i] = s->heap[c];
+        i = c;
+    }
+    if (n > 0) s->heap[i] = last;
+    return top;
+}
+
+// Find the node with the same boxes (encoded) and player region, or -1
+static int SolverLookup(const Solver *s, uint64_t hash, const unsigned char *state, int player, unsigned int *slotOut) {
+    unsigned int slot = (unsigned int)hash & s->tableMask;
+    while (s->table[slot]) {
+        int i = s->table[slot] - 1;
+        const SolverNode *n = SolverNodeAt(s, i);
+        if (n->player == player && memcmp(n->state, state, (size_t)s->b.stateBytes) == 0) {
+            *slotOut = slot;
+            return i;
+        }
+        slot = (slot + 1) & s->tableMask;
+    }
+    *slotOut = slot;
+    return -1;
+}
+
+// Walk the player from `from` to `to` through the current s->occ, appending
+// the steps to out. Returns the new length or -1 if unreachable.
+static int SolverWalk(Solver *s, int from, int to, unsigned char **out, int *cap, int len) {
+    const SolverBoard *b = &s->b;
+    unsigned int gen = ++s->markGen;
+    int qh = 0, qt = 0;
+    s->queue[qt++] = (unsigned short)from;
+    s->mark[from] = gen;
+    s->prev[from] = -1;
+    while (qh < qt && s->mark[to] != gen) {
+        int c = s->queue[qh++];
+        for (int d = 0; d < 4; d++) {
+            int n = SolverStep(b, c, d);
+            if (n < 0 || b->wall[n] || s->occ[n] || s->mark[n] == gen) continue;
+            s->mark[n] = gen;
+            s->prev[n] = (short)d;
+            s->queue[qt++] = (unsigned short)n;
+        }
+    }
+    if (s->mark[to] != gen) return -1;
+    int steps = 0;
+    for (int c = to; c != from; c = SolverStep(b, c, s->prev[c] ^ 1)) steps++;
+    if (len + steps + 1 > *cap) {       // room for the walk and the push after it
+        int grown = *cap * 2 > len + steps + 1 ? *cap * 2 : len + steps + 1;
+        unsigned char *moves = realloc(*out, (size_t)grown);
+        if (!moves) return -1;
+        *out = moves;
+        *cap = grown;
+    }
+    int i = len + steps;
+    for (int c = to; c != from; c = SolverStep(b, c, s->prev[c] ^ 1))
+        (*out)[--i] = (unsigned char)s->prev[c];
+    return len + steps;
+}
+
+// Turn a list of pushes (box cell + direction, root first) into a full step list
+static int SolverPathFromPushes(Solver *s, const unsigned short *from, const unsigned char *dir, int pushes, SolveResult *res) {
+    const SolverBoard *b = &s->b;
+    // Grown by SolverWalk as walks between pushes come in
+    int cap = pushes * 4 + 64;
+    unsigned char *moves = malloc((size_t)cap);
+    if (!moves) return 0;
+
+    memset(s->occ, 0, (size_t)b->cells);
+    for (int i = 0; i < b->nboxes; i++) s->occ[b->startBoxes[i]] = 1;
+    int player = b->startPlayer, len = 0;
+    for (int i = 0; i < pushes; i++) {
+        int d = dir[i];
+        int stand = SolverStep(b, from[i], d ^ 1);
+        len = SolverWalk(s, player, stand, &moves, &cap, len);
+        if (len < 0) { free(moves); return 0; }
+        moves[len++] = (unsigned char)(d | MOVE_PUSH);
+        s->occ[from[i]] = 0;
+        s->occ[SolverStep(b, from[i], d)] = 1;
+        player = from[i];
+    }
+    res->steps = moves;
+    res->moves = len;
+    res->pushes = pushes;
+    return 1;
+}
+
+// Push chain ending at A* node `goal`
+static int SolverBuildPath(Solver *s, int goal, SolveResult *res) {
+    int pushes = SolverNodeAt(s, goal)->g;
+    unsigned short *from = malloc((size_t)(pushes + 1) * sizeof(unsigned short));
+    unsigned char *dir = malloc((size_t)(pushes + 1));
+    int ok = 0;
+    if (from && dir) {
+        int k = pushes;
+        for (const SolverNode *n = SolverNodeAt(s, goal); n->parent >= 0; n = SolverNodeAt(s, n->parent)) {
+            k--;
+            from[k] = n->pushFrom;
+            dir[k] = n->pushDir;
+        }
+        ok = SolverPathFromPushes(s, from, dir, pushes, res);
+    }
+    free(from); free(dir);
+    return ok;
+}
+
+// Generate every legal, non-deadlocked push from (cur, player) into s->kids.
+// cur must be sorted; each child's box list stays sorted.
+static int SolverExpand(Solver *s, const unsigned short *cur, int player) {
+    const SolverBoard *b = &s->b;
+    int nb = b->nboxes, count = 0;
+    memset(s->occ, 0, (size_t)b->cells);
+    memset(s->work.boxes, 0, s->work.words * sizeof(uint64_t));
+    for (int i = 0; i < nb; i++) { s->occ[cur[i]] = 1; BB_SET(s->work.boxes, cur[i]); }
+    SolverReach(s, player);
+    unsigned int reachGen = s->markGen;
+    // SolverReach below reuses mark[]; remember the parent region first
+    unsigned char *reach = s->reach;
+    for (int c = 0; c < b->cells; c++) reach[c] = (s->mark[c] == reachGen);
+
+    uint64_t boxHash = 0;
+    for (int i = 0; i < nb; i++) boxHash ^= b->zobBox[cur[i]];
+    SolverEstimate(s, cur);     // children are rated as one push away from this
+
+    for (int i = 0; i < nb; i++) {
+        int box = cur[i];
+        for (int d = 0; d < 4; d++) {
+            int stand = SolverStep(b, box, d ^ 1);
+            int dest = SolverStep(b, box, d);
+            if (stand < 0 || dest < 0 || !reach[stand]) continue;
+            if (b->wall[dest] || s->occ[dest] || b->pushDist[dest] == SOLVER_INF) continue;
+
+            // Freeze/corral pruning on the pushed box
+            BB_CLEAR(s->work.boxes, box); BB_SET(s->work.boxes, dest);
+            s->work.px = box % b->w; s->work.py = box / b->w;
+            DeadlockKind dk = PushDeadlock(&s->work, dest);
+            BB_CLEAR(s->work.boxes, dest); BB_SET(s->work.boxes, box);
+            if (dk != DEADLOCK_NONE) continue;
+
+            SolverChild *kid = &s->kids[count++];
+            // Replace box i, keep the list sorted
+            int k = 0;
+            for (int j = 0; j < nb; j++) if (j != i) kid->boxes[k++] = cur[j];
+            int pos = nb - 1;
+            while (pos > 0 && kid->boxes[pos-1] > dest) { kid->boxes[pos] = kid->boxes[pos-1]; pos--; }
+            kid->boxes[pos] = (unsigned short)dest;
+            kid->h = s->estimator->moved(s, kid->boxes, i, dest);
+            if (kid->h == SOLVER_H_DEAD) { count--; continue; }
+
+            s->occ[box] = 0; s->occ[dest] = 1;
+            int cp = SolverReach(s, box);
+            s->occ[dest] = 0; s->occ[box] = 1;
+
+            kid->player = (unsigned short)cp;
+            kid->pushFrom = (unsigned short)box;
+            kid->pushDir = (unsigned char)d;
+            kid->hash = boxHash ^ b->zobBox[box] ^ b->zobBox[dest] ^ b->zobPlayer[cp];
+            SolverEncode(b, kid->boxes, kid->state);
+        }
+    }
+    return count;
+}
+
+static void SolverFree(Solver *s) {
+    for (int i = 0; i < s->chunkCount; i++) SolverBlockFree(s, &s->chunks[i]);
+    free(s->chunks);
+    SolverBlockFree(s, &s->tableBlock);
+    SolverBlockFree(s, &s->heapBlock);
+    free(s->cellArena);
+    free(s->heuristicArena);
+    LevelFree(&s->work);
+    free(s);
+}
+
+static const SolverMemoEntry *SolverMemoFind(const SolverMemo *m, uint64_t hash) {
+    if (!m->entries) return NULL;
+    for (unsigned int slot = (unsigned int)hash & m->mask; m->entries[slot].hash; slot = (slot + 1) & m->mask)
+        if (m->entries[slot].hash == hash) return &m->entries[slot];
+    return NULL;
+}
+
+// Insert or overwrite e; false once the memo is full or out of memory
+static bool SolverMemoPut(SolverMemo *m, SolverMemoEntry e) {
+    if (e.hash == 0) e.hash = 1;        // 0 marks empty slots
+    if ((unsigned int)(m->count + 1) * 2 > m->mask) {
+        unsigned int size = m->entries ? (m->mask + 1) * 2 : 4096;
+        if (size > SOLVER_MEMO_MAX) {
+            if (!m->entries || (unsigned int)m->count + 1 > m->mask - m->mask / 4) return false;     // stay under 75% full
+        } else {
+            SolverMemoEntry *entries = calloc(size, sizeof(SolverMemoEntry));
+            if (!entries) return false;
+            for (unsigned int i = 0; m->entries && i <= m->mask; i++) {
+                if (!m->entries[i].hash) continue;
+                unsigned int slot = (unsigned int)m->entries[i].hash & (size - 1);
+                while (entries[slot].hash) slot = (slot + 1) & (size - 1);
+                entries[slot] = m->entries[i];
+            }
+            free(m->entries);
+            m->entries = entries;
+            m->mask = size - 1;
+        }
+    }
+    unsigned int slot = (unsigned int)e.hash & m->mask;
+    while (m->entries[slot].hash && m->entries[slot].hash != e.hash) slot = (slot + 1) & m->mask;
+    if (!m->entries[slot].hash) m->count++;
+    m->entries[slot] = e;
+    return true;
+}
+
+static void SolverMemoFree(SolverMemo *m) {
+    free(m->entries);
+    memset(m, 0, sizeof(*m));
+}
+
+// Reset the search to the start position in s->b. Node, table and heap
+// memory is kept, so repeated searches on one board allocate nothing.
+static int SolverRoot(Solver *s) {
+    const SolverBoard *b = &s->b;
+    int nb = b->nboxes;
+    if (!s->nodeCap && !SolverGrow(s)) return 0;
+    if (!s->table && !SolverRehash(s)) return 0;
+    memset(s->table, 0, (size_t)(s->tableMask + 1) * sizeof(int));
+    s->nodeCount = 0;
+    s->heapCount = 0;
+    s->goal = -1;
+    s->goalRest = 0;
+
+    unsigned short cur[SOLVER_MAX_BOXES];
+    memcpy(cur, b->startBoxes, nb * sizeof(unsigned short));
+    memset(s->occ, 0, (size_t)b->cells);
+    for (int i = 0; i < nb; i++) s->occ[cur[i]] = 1;
+    int player = SolverReach(s, b->startPlayer);
+    uint64_t hash = b->zobPlayer[player];
+    for (int i = 0; i < nb; i++) hash ^= b->zobBox[cur[i]];
+    SolverNode *root = SolverNodeAt(s, 0);
+    root->parent = -1;
+    root->player = (unsigned short)player;
+    root->g = root->pushFrom = 0;
+    root->pushDir = 0;
+    SolverEncode(b, cur, root->state);
+    s->nodeCount = 1;
+    unsigned int slot;
+    SolverLookup(s, hash, root->state, player, &slot);
+    s->table[slot] = 1;
+    s->best = 0;
+    s->bestH = SolverEstimate(s, cur);
+    if (s->bestH == SOLVER_H_DEAD) return 1;    // nothing to search: SolverRun reports it exhausted
+    return SolverHeapPush(s, s->bestH, 0, 0);
+}
+
+// Run A* for up to `budget` expansions (SEARCH_RUNNING when it runs out;
+// calling again continues). With a memo, known dead positions are skipped and
+// known solved ones get their exact distance, so popping one ends the search.
+static SearchState SolverRun(Solver *s, long long budget, SolveResult *res) {
+    const SolverBoard *b = &s->b;
+    size_t stateBytes = (size_t)b->stateBytes;
+    unsigned short cur[SOLVER_MAX_BOXES];
+    unsigned int slot;
+    for (long long n = 0; s->heapCount > 0; n++) {
+        SolverHeapItem it = SolverHeapPop(s);
+        if (it.g != SolverNodeAt(s, it.node)->g) { n--; continue; }    // stale entry
+        if (it.f == it.g) { s->goal = it.node; return SEARCH_GOAL; }     // h == 0: all boxes home
+        const SolverMemoEntry *known = s->memo ? SolverMemoFind(s->memo, SolverNodeHash(s, it.node, cur)) : NULL;
+        if (known && !known->dead) {
+            s->goal = it.node;
+            s->goalRest = known->pushes;
+            return SEARCH_GOAL;
+        }
+        if (n == budget) {
+            SolverHeapPush(s, it.f, it.g, it.node);     // cannot fail: the entry was just popped
+            return SEARCH_RUNNING;
+        }
+        res->expanded++;
+
+        int ni = it.node;
+        const SolverNode *parent = SolverNodeAt(s, ni);
+        SolverDecode(b, parent->state, cur);
+        int kids = SolverExpand(s, cur, parent->player);
+        unsigned int g = parent->g + 1u;
+        res->generated += kids;
+
+        for (int k = 0; k < kids; k++) {
+            const SolverChild *kid = &s->kids[k];
+            unsigned int h = kid->h;
+            if (s->memo && (known = SolverMemoFind(s->memo, kid->hash)) != NULL) {
+                if (known->dead) continue;
+                h = known->pushes;
+            }
+            int existing = SolverLookup(s, kid->hash, kid->state, kid->player, &slot);
+            if (existing >= 0) {
+                SolverNode *e = SolverNodeAt(s, existing);
+                if (g >= e->g) continue;
+                e->g = (unsigned short)g; e->parent = ni;
+                e->pushFrom = kid->pushFrom; e->pushDir = kid->pushDir;
+                if (!SolverHeapPush(s, g + h, g, existing)) return SEARCH_FAILED;
+                continue;
+            }
+            if (s->nodeCount == s->nodeCap && !SolverGrow(s)) return SEARCH_FAILED;
+            int idx = s->nodeCount++;
+            SolverNode *node = SolverNodeAt(s, idx);
+            node->parent = ni;
+            node->player = kid->player;
+            node->g = (unsigned short)g;
+            node->pushFrom = kid->pushFrom;
+            node->pushDir = kid->pushDir;
+            memcpy(node->state, kid->state, stateBytes);
+            s->table[slot] = idx + 1;
+            if ((unsigned int)s->nodeCount * 2 > s->tableMask && !SolverRehash(s)) return SEARCH_FAILED;
+            if (!SolverHeapPush(s, g + h, g, idx)) return SEARCH_FAILED;
+            if (h < s->bestH) { s->best = idx; s->bestH = h; }
+        }
+    }
+    return SEARCH_EXHAUSTED;
+}
+
+// Solve the level from its current position. maxNodes bounds the number of
+// expansions (0 = unlimited). The caller frees res->steps with free().
+int SolveLevel(const Level *lvl, long long maxNodes, SolveResult *res) {
+    return SolveLevelWith(lvl, HEURISTIC_NEAREST, maxNodes, res);
+}
+
+// SolveLevel with a choice of lower bound (see solverHeuristics)
+int SolveLevelWith(const Level *lvl, Heuristic heuristic, long long maxNodes, SolveResult *res) {
+    SolveOptions opt = { heuristic, maxNodes, 0, NULL };
+    return SolveLevelOptions(lvl, &opt, res);
+}
+
+static Solver *SolverCreate(const SolveOptions *opt) {
+    Solver *s = calloc(1, sizeof(Solver));
+    if (!s) return NULL;
+    s->b.heuristic = opt->heuristic;
+    s->memBudget = opt->memoryBudget;
+    s->spillDir = opt->spillDir;
+    return s;
+}
+
+static void SolverFinish(Solver *s, SearchState st, double t0, SolveResult *res) {
+    if (st == SEARCH_GOAL && SolverBuildPath(s, s->goal, res)) res->solved = 1;
+    else if (st == SEARCH_EXHAUSTED) res->solved = 0;
+    else res->solved = -1;
+
+    res->peakBytes = s->peakBytes;
+    res->spillBytes = s->peakSpill;
+    res->seconds = NowSeconds() - t0;
+}
+
+// SolveLevel with every knob, including a RAM budget for the tables
+int SolveLevelOptions(const Level *lvl, const SolveOptions *opt, SolveResult *res) {
+    memset(res, 0, sizeof(*res));
+    double t0 = NowSeconds();
+    Solver *s = SolverCreate(opt);
+    if (!s) return 0;
+    // No boxes, too many or no memory
+    if (!SolverInit(s, lvl) || !SolverRoot(s)) { SolverFree(s); res->solved = -1; return -1; }
+
+    SearchState st = SolverRun(s, opt->maxNodes > 0 ? opt->maxNodes : LLONG_MAX, res);
+    SolverFinish(s, st, t0, res);
+    SolverFree(s);
+    return res->solved;
+}
+
+// Headless entry point: `my_game --solve [repeat]` solves the bundled level
+// and prints throughput, peak table memory and solution length.
+static int RunSolveCli(int repeat) {
+    Level *lvl = calloc(1, sizeof(Level));
+    if (!lvl) return 1;
+    LoadLevel(lvl, levelMap);
+    if (repeat < 1) repeat = 1;
+
+    SolveResult res = {0};
+    double total = 0;
+    long long expanded = 0;
+    for (int r = 0; r < repeat; r++) {
+        free(res.steps);
+        SolveLevel(lvl, 0, &res);
+        total += res.seconds;
+        expanded += res.expanded;
+    }
+    LevelFree(lvl);
+    free(lvl);
+
+    if (res.solved != 1) {
+        printf("level 1: %s after %lld nodes\n", res.solved == 0 ? "no solution" : "search limit hit", res.expanded);
+        free(res.steps);
+        return 2;
+    }
+    double avg = total / repeat;
+    printf("level 1: solved, %d pushes / %d moves\n", res.pushes, res.moves);
+    printf("  nodes expanded %lld, generated %lld\n", res.expanded, res.generated);
+    printf("  time %.3f ms (avg of %d), %.0f nodes/sec\n", avg * 1e3, repeat, total > 0 ? expanded / total : 0.0);
+    printf("  peak table memory %.1f KB\n", res.peakBytes / 1024.0);
+    char *lurd = malloc((size_t)res.moves + 1);
+    if (lurd && LurdEncode(res.steps, res.moves, lurd, (size_t)res.moves + 1) >= 0) printf("  lurd %s\n", lurd);
+    free(lurd);
+    free(res.steps);
+    return 0;
+}
+
+// `my_game --bench-heuristics [pack.xsb] [maxNodes]`: solve every level of a
+// pack (the bundled level without one) with each lower bound and print nodes
+// expanded against time per node, then totals per heuristic. A tighter bound
+// expands fewer nodes but costs more per node; the totals show which wins on
+// that pack.
+static int RunHeuristicBenchCli(const char *pack, long long maxNodes) {
+    PackReader pr;
+    if (pack && !PackOpen(&pr, pack)) { fprintf(stderr, "cannot open %s\n", pack); return 1; }
+    Level *lvl = calloc(1, sizeof(Level));
+    if (!lvl) { if (pack) PackClose(&pr); return 1; }
+    if (maxNodes <= 0) maxNodes = 2000000;
+
+    struct { int solved, levels, pushes; long long nodes; double seconds; } total[HEURISTIC_COUNT] = {0};
+    bool mismatch = false;
+    printf("level\theuristic\tresult\tpushes\tnodes\tms\tus_per_node\n");
+    LevelStatus st = LEVEL_OK;
+    for (int index = 1; pack ? PackNext(&pr, lvl, &st) : index == 1; index++) {
+        if (!pack) st = LoadLevel(lvl, levelMap);
+        if (st != LEVEL_OK) continue;
+        int optimal = -1;
+        for (int h = 0; h < HEURISTIC_COUNT; h++) {
+            SolveResult res;
+            SolveLevelWith(lvl, (Heuristic)h, maxNodes, &res);
+            free(res.steps);
+            const char *verdict = res.solved == 1 ? "solved" : res.solved == 0 ? "unsolvable" : "gave-up";
+            printf("%d\t%s\t%s\t%d\t%lld\t%.2f\t%.2f\n", index, HeuristicName((Heuristic)h), verdict, res.pushes,
+                   res.expanded, res.seconds * 1e3, res.expanded ? res.seconds * 1e6 / res.expanded : 0.0);
+            total[h].levels++;
+            total[h].seconds += res.seconds;
+            total[h].nodes += res.expanded;
+            if (res.solved != 1) continue;
+            total[h].solved++;
+            total[h].pushes += res.pushes;
+            // The admissible bounds must agree on the optimal push count
+            if (h == HEURISTIC_GREEDY) continue;
+            if (optimal >= 0 && res.pushes != optimal) mismatch = true;
+            optimal = res.pushes;
+        }
+    }
+    if (pack) PackClose(&pr);
+    LevelFree(lvl);
+    free(lvl);
+
+    for (int h = 0; h < HEURISTIC_COUNT; h++) {
+        printf("# %-9s %d/%d solved, %d pushes, %lld nodes, %.1f ms, %.2f us/node\n", HeuristicName((Heuristic)h),
+               total[h].solved, total[h].levels, total[h].pushes, total[h].nodes, total[h].seconds * 1e3,
+               total[h].nodes ? total[h].seconds * 1e6 / total[h].nodes : 0.0);
+    }
+    if (mismatch) printf("# admissible heuristics disagree on an optimal push count\n");
+    return mismatch ? 2 : 0;
+}
+
+// `my_game --solve-capped pack.xsb [level] [budgetMB] [maxNodes] [heuristic]`:
+// solve one level with the solver tables held to budgetMB of RAM (default
+// 512; past it they continue in a temporary file) and print throughput and
+// table size once a second.
+static int RunCappedSolveCli(const char *pack, int index, long long budgetMB, long long maxNodes, const char *heuristic) {
+    Heuristic h = heuristic ? HeuristicParse(heuristic) : HEURISTIC_NEAREST;
+    if (h == HEURISTIC_COUNT) { fprintf(stderr, "unknown heuristic %s\n", heuristic); return 1; }
+    if (index < 1) index = 1;
+    if (budgetMB <= 0) budgetMB = 512;
+    PackReader pr;
+    if (!PackOpen(&pr, pack)) { fprintf(stderr, "cannot open %s\n", pack); return 1; }
+    Level *lvl = calloc(1, sizeof(Level));
+    LevelStatus st = LEVEL_EMPTY;
+    bool found = false;
+    while (lvl && !found && PackNext(&pr, lvl, &st)) found = pr.index == index;
+    PackClose(&pr);
+    if (!found || st != LEVEL_OK) {
+        fprintf(stderr, "level %d: %s\n", index, found ? LevelStatusText(st) : "not in pack");
+        if (lvl) LevelFree(lvl);
+        free(lvl);
+        return 1;
+    }
+
+    SolveOptions opt = { h, maxNodes, (size_t)budgetMB << 20, NULL };
+    SolveResult res = {0};
+    double t0 = NowSeconds();
+    Solver *s = SolverCreate(&opt);
+    bool ready = s && SolverInit(s, lvl) && SolverRoot(s);
+    LevelFree(lvl);
+    free(lvl);
+    if (!ready) {
+        fprintf(stderr, "level %d: beyond the solver\n", index);
+        if (s) SolverFree(s);
+        return 1;
+    }
+    const SolverBoard *b = &s->b;
+    printf("level %d: %d boxes on %d floor cells, %d-byte box lists (%d before), %zu bytes per node, %s, budget %lld MB\n",
+           index, b->nboxes, b->floors, b->stateBytes, b->nboxes * (int)sizeof(unsigned short), s->nodeStride,
+           HeuristicName(b->heuristic), budgetMB);
+    printf("seconds\texpanded\tstored\tnodes_per_sec\tram_mb\tspill_mb\n");
+
+    SearchState state = SEARCH_RUNNING;
+    long long left = maxNodes > 0 ? maxNodes : LLONG_MAX, lastExpanded = 0;
+    double lastReport = t0;
+    while (state == SEARCH_RUNNING && left > 0) {
+        long long before = res.expanded;
+        state = SolverRun(s, left < 4096 ? left : 4096, &res);
+        left -= res.expanded - before;
+        double now = NowSeconds();
+        if (now - lastReport < 1.0 && state == SEARCH_RUNNING && left > 0) continue;
+        printf("%.1f\t%lld\t%d\t%.0f\t%.1f\t%.1f\n", now - t0, res.expanded, s->nodeCount,
+               (res.expanded - lastExpanded) / (now - lastReport), s->ramBytes / 1048576.0, s->spillBytes / 1048576.0);
+        fflush(stdout);
+        lastReport = now;
+        lastExpanded = res.expanded;
+    }
+    SolverFinish(s, state, t0, &res);
+    SolverFree(s);
+    free(res.steps);
+    printf("# %s after %lld nodes in %.1f s (%.0f nodes/sec), %d pushes; tables peaked at %.1f MB, %.1f MB of it spilled\n",
+           res.solved == 1 ? "solved" : res.solved == 0 ? "no solution" : "gave up", res.expanded, res.seconds,
+           res.seconds > 0 ? res.expanded / res.seconds : 0.0, res.pushes, res.peakBytes / 1048576.0, res.spillBytes / 1048576.0);
+    return res.solved == 1 ? 0 : 2;
+}
+// ========================================================================
+
+// =================== [ Hint engine ] ===================
+// Answers "what should I push next?" on a worker thread while the game keeps
+// drawing. HintPost hands over the position after every move; the worker
+// drops whatever it was searching and starts on the newest one. The search
+// is the push-optimal A* above, run in slices: between slices it publishes
+// the first push toward the most promising position so far (HINT_GUESS),
+// and once a solution is found, the first push of an optimal one
+// (HINT_SOLVED). Answers go through a triple buffer, so neither side ever
+// waits for the other.
+//
+// Work carries over between queries on the same board in a SolverMemo:
+// every position on a found solution is stored with its exact distance, and
+// every position of an exhausted search is stored as dead. Following a hint,
+// undoing, or walking around without pushing therefore lands on positions
+// that are answered straight from the memo, and later searches stop as soon
+// as they reach one. Solver tables keep their memory between queries too.
+
+#define HINT_SLICE 256              // expansions between checks for a newer position
+#define HINT_FRESH 4u               // flag in HintEngine.middle: an unread answer waits there
+
+struct HintEngine {
+    pthread_t thread;
+    pthread_mutex_t lock;           // guards pending, postTime and quit
+    pthread_cond_t wake;
+    Level pending;                  // last posted position
+    double postTime;
+    bool quit;
+    atomic_uint posted;             // number of the last HintPost
+
+    // worker only
+    Level lvl;
+    Solver *solver;
+    SolverMemo memo;
+    long long maxNodes;
+
+    // the worker fills slots[back] and swaps it with middle; HintGet swaps
+    // front with middle when a fresh answer is there
+    Hint slots[3];
+    unsigned int back, front;
+    atomic_uint middle;
+};
+
+static void HintPublish(HintEngine *he, Hint *h, long long expanded) {
+    h->nodes = expanded;
+    h->known = he->memo.count;
+    he->slots[he->back] = *h;
+    he->back = atomic_exchange_explicit(&he->middle, he->back | HINT_FRESH, memory_order_acq_rel) & 3;
+}
+
+// First push on the way from the root to node n; false for the root itself
+static bool HintFirstPush(const Solver *s, int n, int *box, int *dir) {
+    if (n <= 0) return false;
+    const SolverNode *node = SolverNodeAt(s, n);
+    while (node->parent > 0) node = SolverNodeAt(s, node->parent);
+    *box = node->pushFrom;
+    *dir = node->pushDir;
+    return true;
+}
+
+// A* is push-optimal, so every tail of the solution it found is optimal too:
+// store each position on it with its exact distance and next push
+static void HintLearnPath(HintEngine *he) {
+    const Solver *s = he->solver;
+    unsigned short boxes[SOLVER_MAX_BOXES];
+    unsigned int total = SolverNodeAt(s, s->goal)->g + s->goalRest;
+    const SolverNode *child = NULL;
+    for (int n = s->goal; n >= 0; n = child->parent) {
+        const SolverNode *node = SolverNodeAt(s, n);
+        SolverMemoEntry e = { SolverNodeHash(s, n, boxes), total - node->g, 0, 0, 0 };
+        bool known = !child && s->goalRest;     // a memo hit: already stored
+        if (child) {
+            e.box = child->pushFrom;
+            e.dir = child->pushDir;
+        }
+        child = node;
+        if (!known && !SolverMemoPut(&he->memo, e)) return;
+    }
+}
+
+// A search that ran out of positions without a solution saw everything
+// reachable from its root: all of it is dead
+static void HintLearnDead(HintEngine *he) {
+    const Solver *s = he->solver;
+    unsigned short boxes[SOLVER_MAX_BOXES];
+    for (int n = 0; n < s->nodeCount; n++) {
+        SolverMemoEntry e = { SolverNodeHash(s, n, boxes), 0, 0, 0, 1 };
+        if (!SolverMemoPut(&he->memo, e)) return;
+    }
+}
+
+static bool HintSameBoard(const Solver *s, const Level *lvl) {
+    const Level *w = &s->work;
+    return w->w == lvl->w && w->h == lvl->h
+        && memcmp(w->walls, lvl->walls, (size_t)lvl->words * sizeof(uint64_t)) == 0
+        && memcmp(w->targets, lvl->targets, (size_t)lvl->words * sizeof(uint64_t)) == 0;
+}
+
+// Answer query number `query` for he->lvl, publishing as the answer improves.
+// Returns early when a newer position is posted.
+static void HintSearch(HintEngine *he, unsigned int query, double postTime) {
+    Hint h = { query, HINT_NONE, -1, 0, -1, 0, 0, -1, -1 };
+    const Level *lvl = &he->lvl;
+    // Memo entries belong to one board: a new board starts from scratch
+    if (he->solver && !HintSameBoard(he->solver, lvl)) {
+        SolverFree(he->solver);
+        he->solver = NULL;
+        SolverMemoFree(&he->memo);
+    }
+    bool ready;
+    if (he->solver) {
+        ready = SolverBoardStart(&he->solver->b, lvl);
+    } else {
+        he->solver = calloc(1, sizeof(Solver));
+        ready = he->solver && SolverInit(he->solver, lvl);
+        if (he->solver && !ready) { SolverFree(he->solver); he->solver = NULL; }
+    }
+    Solver *s = he->solver;
+    ready = ready && lvl->boxesOff > 0 && SolverRoot(s);
+    if (!ready) {
+        // Already solved, or beyond the solver (no boxes, too many, no memory)
+        if (lvl->boxesOff == 0) { h.status = HINT_SOLVED; h.pushes = 0; }
+        h.firstMs = h.solvedMs = (NowSeconds() - postTime) * 1e3;
+        HintPublish(he, &h, 0);
+        return;
+    }
+    s->memo = &he->memo;
+
+    unsigned short boxes[SOLVER_MAX_BOXES];
+    const SolverMemoEntry *known = SolverMemoFind(&he->memo, SolverNodeHash(s, 0, boxes));
+    SolveResult res = {0};
+    SearchState st = known ? (known->dead ? SEARCH_EXHAUSTED : SEARCH_GOAL) : SEARCH_RUNNING;
+    if (known && !known->dead) { s->goal = 0; s->goalRest = known->pushes; }
+    // The first slice is a single expansion, so a first guess comes quickly
+    for (long long budget = 1; st == SEARCH_RUNNING; budget = HINT_SLICE) {
+        st = SolverRun(s, budget, &res);
+        if (atomic_load(&he->posted) != query) return;
+        if (st != SEARCH_RUNNING) break;
+        if (he->maxNodes > 0 && res.expanded >= he->maxNodes) st = SEARCH_FAILED;
+        int box, dir;
+        if (HintFirstPush(s, s->best, &box, &dir) && (box != h.box || dir != h.dir)) {
+            h.status = HINT_GUESS;
+            h.box = box;
+            h.dir = dir;
+            h.pushes = (int)(SolverNodeAt(s, s->best)->g + s->bestH);
+            if (h.firstMs < 0) h.firstMs = (NowSeconds() - postTime) * 1e3;
+            HintPublish(he, &h, res.expanded);
+        }
+    }
+
+    if (st == SEARCH_GOAL) {
+        if (s->goal > 0) {
+            HintLearnPath(he);
+            HintFirstPush(s, s->goal, &h.box, &h.dir);
+        } else {
+            h.box = known->box;
+            h.dir = known->dir;
+        }
+        h.status = HINT_SOLVED;
+        h.pushes = (int)(SolverNodeAt(s, s->goal)->g + s->goalRest);
+    } else if (st == SEARCH_EXHAUSTED) {
+        if (!known) HintLearnDead(he);
+        h.status = HINT_DEAD;
+        h.box = -1;
+    }
+    // SEARCH_FAILED (node limit or no memory) leaves the last guess standing
+    h.solvedMs = (NowSeconds() - postTime) * 1e3;
+    if (h.firstMs < 0) h.firstMs = h.solvedMs;
+    HintPublish(he, &h, res.expanded);
+}
+
+static void *HintWorkerMain(void *arg) {
+    HintEngine *he = arg;
+    unsigned int served = 0;
+    pthread_mutex_lock(&he->lock);
+    for (;;) {
+        while (!he->quit && atomic_load(&he->posted) == served) pthread_cond_wait(&he->wake, &he->lock);
+        if (he->quit) break;
+        served = atomic_load(&he->posted);
+        double postTime = he->postTime;
+        bool copied = LevelCopyBoard(&he->lvl, &he->pending);
+        pthread_mutex_unlock(&he->lock);
+        if (copied) HintSearch(he, served, postTime);
+        pthread_mutex_lock(&he->lock);
+    }
+    pthread_mutex_unlock(&he->lock);
+    return NULL;
+}
+
+// Start the worker. maxNodes bounds each query's search (0 = unlimited);
+// NULL when out of memory or threads.
+HintEngine *HintStart(long long maxNodes) {
+    HintEngine *he = calloc(1, sizeof(HintEngine));
+    if (!he) return NULL;
+    he->maxNodes = maxNodes;
+    he->back = 1;
+    atomic_init(&he->middle, 2);
+    atomic_init(&he->posted, 0);
+    pthread_mutex_init(&he->lock, NULL);
+    pthread_cond_init(&he->wake, NULL);
+    if (pthread_create(&he->thread, NULL, HintWorkerMain, he) != 0) {
+        pthread_mutex_destroy(&he->lock);
+        pthread_cond_destroy(&he->wake);
+        free(he);
+        return NULL;
+    }
+    return he;
+}
+
+// Hand over lvl's position (board and boxes; history is not copied). Costs a
+// copy of the layers; returns the query number its answers will carry.
+unsigned int HintPost(HintEngine *he, const Level *lvl) {
+    pthread_mutex_lock(&he->lock);
+    unsigned int query = atomic_load(&he->posted);
+    if (LevelCopyBoard(&he->pending, lvl)) {
+        he->postTime = NowSeconds();
+        atomic_store(&he->posted, ++query);
+        pthread_cond_signal(&he->wake);
+    }
+    pthread_mutex_unlock(&he->lock);
+    return query;
+}
+
+// Latest answer published; true when it answers the last position posted.
+// Never blocks. One reader thread only.
+bool HintGet(HintEngine *he, Hint *out) {
+    if (atomic_load_explicit(&he->middle, memory_order_relaxed) & HINT_FRESH)
+        he->front = atomic_exchange_explicit(&he->middle, he->front, memory_order_acq_rel) & 3;
+    *out = he->slots[he->front];
+    return out->query == atomic_load(&he->posted);
+}
+
+void HintStop(HintEngine *he) {
+    if (!he) return;
+    pthread_mutex_lock(&he->lock);
+    he->quit = true;
+    atomic_fetch_add(&he->posted, 1);     // abandon the running search
+    pthread_cond_signal(&he->wake);
+    pthread_mutex_unlock(&he->lock);
+    pthread_join(he->thread, NULL);
+    pthread_mutex_destroy(&he->lock);
+    pthread_cond_destroy(&he->wake);
+    if (he->solver) SolverFree(he->solver);
+    SolverMemoFree(&he->memo);
+    LevelFree(&he->pending);
+    LevelFree(&he->lvl);
+    free(he);
+}
+
+// Wait for the proven answer to `query` (or its final guess)
+static Hint HintWait(HintEngine *he, unsigned int query) {
+    Hint h;
+    while (!HintGet(he, &h) || h.query != query || h.solvedMs < 0) sched_yield();
+    return h;
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void HintReport(const char *phase, double *ms, int count, int hits) {
+    if (count == 0) return;
+    qsort(ms, (size_t)count, sizeof(double), CompareDoubles);
+    double sum = 0;
+    for (int i = 0; i < count; i++) sum += ms[i];
+    printf("  %-8s %5d positions, %5d from memo, latency avg %.3f ms, p50 %.3f, p99 %.3f, max %.3f\n", phase, count, hits,
+           sum / count, ms[count / 2], ms[(count * 99) / 100 < count ? (count * 99) / 100 : count - 1], ms[count - 1]);
+}
+
+// Headless hint benchmark: `my_game --hint-latency` follows the hints through
+// the bundled level one move at a time (posting after every step, as the game
+// does), then undoes every move. Prints the latency to the proven answer per
+// position and how many came straight from the memo.
+static int RunHintLatencyCli(void) {
+    Level *lvl = calloc(1, sizeof(Level));
+    HintEngine *he = HintStart(0);
+    unsigned char *path = NULL;
+    double *ms = NULL;
+    int status = 1;
+    if (!lvl || !he || LoadLevel(lvl, levelMap) != LEVEL_OK) goto done;
+    int cells = lvl->w * lvl->h;
+    path = malloc((size_t)cells + 1);
+    ms = malloc(sizeof(double) * 65536);
+    if (!path || !ms) goto done;
+
+    int count = 0, hits = 0;
+    for (;;) {
+        Hint h = HintWait(he, HintPost(he, lvl));
+        if (count < 65536) ms[count++] = h.solvedMs;
+        hits += h.nodes == 0;
+        if (h.status != HINT_SOLVED || h.pushes == 0) {
+            if (h.status != HINT_SOLVED) printf("level 1: no hint (%d)\n", h.status);
+            break;
+        }
+        // Walk one step of the way (the position before the push repeats in
+        // the memo under its normalized player), or push
+        int n = LevelPushPath(lvl, h.box, h.dir, path, cells + 1);
+        if (n <= 0) { printf("level 1: hint push not possible\n"); goto done; }
+        TryMove(lvl, dirDX[path[0] & MOVE_DIR_MASK], dirDY[path[0] & MOVE_DIR_MASK]);
+    }
+    int pushes = 0;
+    for (int i = 0; i < lvl->log.pos; i++) pushes += (lvl->log.moves[i] & MOVE_PUSH) != 0;
+    printf("level 1: %s after %d moves, %d pushes\n", LevelSolved(lvl) ? "solved" : "stuck", lvl->moveCount, pushes);
+    HintReport("forward", ms, count, hits);
+
+    int forward = lvl->moveCount;
+    count = hits = 0;
+    for (int i = 0; i < forward; i++) {
+        UndoMove(lvl);
+        Hint h = HintWait(he, HintPost(he, lvl));
+        if (count < 65536) ms[count++] = h.solvedMs;
+        hits += h.nodes == 0;
+    }
+    HintReport("undo", ms, count, hits);
+    status = LevelSolved(lvl) || forward > 0 ? 0 : 2;
+
+done:
+    HintStop(he);
+    free(path);
+    free(ms);
+    if (lvl) LevelFree(lvl);
+    free(lvl);
+    return status;
+}
+// ========================================================================
+
+// =================== [ Background solve ] ===================
+// The S key's full solve, on a worker thread so the window keeps drawing and
+// taking input. The search runs in slices and stops early once the job is
+// finished from outside (a move, a restart or a new level made it stale).
+
+#define SOLVE_JOB_SLICE 4096        // expansions between checks for a cancel
+
+struct SolveJob {
+    pthread_t thread;
+    Level lvl;                      // worker's own copy of the position
+    long long maxNodes;
+    SolveResult res;
+    atomic_bool cancel;
+    atomic_bool done;
+};
+
+static void *SolveJobMain(void *arg) {
+    SolveJob *job = arg;
+    SolveResult *res = &job->res;
+    double t0 = NowSeconds();
+    SolveOptions opt = { HEURISTIC_NEAREST, job->maxNodes, 0, NULL };
+    Solver *s = SolverCreate(&opt);
+    if (s && SolverInit(s, &job->lvl) && SolverRoot(s)) {
+        long long left = job->maxNodes > 0 ? job->maxNodes : LLONG_MAX;
+        SearchState st = SEARCH_RUNNING;
+        while (st == SEARCH_RUNNING && left > 0 && !atomic_load(&job->cancel)) {
+            long long before = res->expanded;
+            st = SolverRun(s, left < SOLVE_JOB_SLICE ? left : SOLVE_JOB_SLICE, res);
+            left -= res->expanded - before;
+        }
+        SolverFinish(s, st, t0, res);
+    } else {
+        res->solved = -1;
+    }
+    if (s) SolverFree(s);
+    atomic_store(&job->done, true);
+    return NULL;
+}
+
+// Start solving lvl's current position (maxNodes 0 = unlimited); NULL when
+// the thread or the copy cannot be made
+SolveJob *SolveJobStart(const Level *lvl, long long maxNodes) {
+    SolveJob *job = calloc(1, sizeof(SolveJob));
+    if (!job) return NULL;
+    job->maxNodes = maxNodes;
+    atomic_init(&job->cancel, false);
+    atomic_init(&job->done, false);
+    if (!LevelCopyBoard(&job->lvl, lvl) || pthread_create(&job->thread, NULL, SolveJobMain, job) != 0) {
+        LevelFree(&job->lvl);
+        free(job);
+        return NULL;
+    }
+    return job;
+}
+
+// True once SolveJobFinish would not wait
+bool SolveJobDone(const SolveJob *job) {
+    return atomic_load(&job->done);
+}
+
+// Stop the search if it is still running, wait for the thread and release
+// the job. res (may be NULL) gets the result; a stopped search reports -1.
+int SolveJobFinish(SolveJob *job, SolveResult *res) {
+    if (!job) return -1;
+    atomic_store(&job->cancel, true);
+    pthread_join(job->thread, NULL);
+    int solved = job->res.solved;
+    if (res) *res = job->res;
+    else free(job->res.steps);
+    LevelFree(&job->lvl);
+    free(job);
+    return solved;
+}
+// ========================================================================
+
+// =================== [ Parallel solver (work stealing) ] ===================
+// Iterative-deepening A* spread over all cores. Every worker owns a
+// Chase-Lev deque of nodes: it works depth-first from the bottom of its own
+// deque and steals from the top of a random victim when it runs dry.
+// Duplicate states are cut with a lock-free transposition table, sharded by
+// the top hash bits, whose entries pack (hash check, iteration, g) into one
+// 64-bit word so inserts and improvements are a single CAS.
+
+#define PAR_MAX_THREADS 64
+#define PAR_TT_SHARD_BITS 6
+#define PAR_TT_BITS 21            // 2M entries = 16 MB in total
+#define PAR_TT_PROBES 16
+#define PAR_ARENA_CHUNK (1 << 20)
+
+// Search node; lives in its owner's arena until the solve finishes
+typedef struct ParNode {
+    const struct ParNode *parent;
+    unsigned short g, player, pushFrom;
+    unsigned char pushDir;
+    unsigned short boxes[];       // nboxes entries, sorted
+} ParNode;
+
+typedef struct {
+    long long size;
+    _Atomic(ParNode *) buf[];
+} ParDequeArray;
+
+typedef struct {
+    atomic_llong top, bottom;
+    _Atomic(ParDequeArray *) array;
+    ParDequeArray *retired[48];   // grown-out-of arrays, freed at the end
+    int retiredCount;
+} ParDeque;
+
+#define PAR_EMPTY ((ParNode *)0)
+#define PAR_ABORT ((ParNode *)1)
+
+static ParDequeArray *ParDequeArrayNew(long long size) {
+    ParDequeArray *a = malloc(sizeof(ParDequeArray) + (size_t)size * sizeof(_Atomic(ParNode *)));
+    if (a) a->size = size;
+    return a;
+}
+
+static int ParDequeInit(ParDeque *q) {
+    atomic_init(&q->top, 0);
+    atomic_init(&q->bottom, 0);
+    ParDequeArray *a = ParDequeArrayNew(1024);
+    atomic_init(&q->array, a);
+    q->retiredCount = 0;
+    return a != NULL;
+}
+
+static void ParDequeFree(ParDeque *q) {
+    free(atomic_load(&q->array));
+    for (int i = 0; i < q->retiredCount; i++) free(q->retired[i]);
+}
+
+// Owner only
+static int ParDequePush(ParDeque *q, ParNode *x) {
+    long long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    ParDequeArray *a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    if (b - t > a->size - 1) {
+        if (q->retiredCount == 48) return 0;
+        ParDequeArray *na = ParDequeArrayNew(a->size * 2);
+        if (!na) return 0;
+        for (long long i = t; i < b; i++)
+            atomic_store_explicit(&na->buf[i % na->size],
+                atomic_load_explicit(&a->buf[i % a->size], memory_order_relaxed), memory_order_relaxed);
+        q->retired[q->retiredCount++] = a;
+        atomic_store_explicit(&q->array, na, memory_order_release);
+        a = na;
+    }
+    atomic_store_explicit(&a->buf[b % a->size], x, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_release);   // publishes the node to thieves
+    return 1;
+}
+
+// Owner only
+static ParNode *ParDequeTake(ParDeque *q) {
+    long long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    ParDequeArray *a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+    ParNode *x = PAR_EMPTY;
+    if (t <= b) {
+        x = atomic_load_explicit(&a->buf[b % a->size], memory_order_relaxed);
+        if (t == b) {
+            // Last element: race the thieves for it
+            if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                    memory_order_seq_cst, memory_order_relaxed)) x = PAR_EMPTY;
+            atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    }
+    return x;
+}
+
+// Any thread
+static ParNode *ParDequeSteal(ParDeque *q) {
+    long long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+    if (t >= b) return PAR_EMPTY;
+    ParDequeArray *a = atomic_load_explicit(&q->array, memory_order_acquire);
+    ParNode *x = atomic_load_explicit(&a->buf[t % a->size], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed)) return PAR_ABORT;
+    return x;
+}
+
+// Transposition table entry: hash bits 24..63 | iteration << 16 | g
+typedef struct {
+    _Atomic(uint64_t) *shards[1 << PAR_TT_SHARD_BITS];
+    unsigned int shardMask;       // entries per shard - 1
+} ParTable;
+
+// Returns 1 when the caller reached the state first or with fewer pushes
+static int ParTableClaim(ParTable *tt, uint64_t hash, unsigned int iter, unsigned int g) {
+    _Atomic(uint64_t) *shard = tt->shards[hash >> (64 - PAR_TT_SHARD_BITS)];
+    uint64_t check = hash & ~(uint64_t)0xFFFFFF;
+    uint64_t want = check | (uint64_t)(iter & 0xFF) << 16 | g;
+    unsigned int slot = (unsigned int)hash & tt->shardMask;
+    for (int probe = 0; probe < PAR_TT_PROBES; probe++, slot = (slot + 1) & tt->shardMask) {
+        uint64_t e = atomic_load_explicit(&shard[slot], memory_order_relaxed);
+        for (;;) {
+            int mine = (e & ~(uint64_t)0xFFFFFF) == check;
+            int fresh = ((e >> 16) & 0xFF) == (iter & 0xFF);
+            if (e != 0 && fresh && !mine) break;                         // someone else's state
+            if (e != 0 && fresh && mine && (e & 0xFFFF) <= g) return 0;  // seen as cheap or cheaper
+            if (atomic_compare_exchange_weak_explicit(&shard[slot], &e, want,
+                    memory_order_relaxed, memory_order_relaxed)) return 1;
+        }
+    }
+    return 1;   // neighbourhood full: search it again rather than risk a wrong cut
+}
+
+typedef struct ParShared ParShared;
+
+typedef struct {
+    ParShared *sh;
+    int id;
+    pthread_t thread;
+    Solver *s;                    // per-thread scratch (reach, deadlock work level)
+    ParDeque deque;
+    char **chunks;                // arena, rewound every iteration
+    int chunkCount, chunkCap;
+    int chunkLive;                // chunks in use this iteration
+    size_t chunkUsed;
+    long long expanded, generated;
+    uint64_t rng;
+} ParWorker;
+
+struct ParShared {
+    const SolverBoard *b;
+    size_t nodeBytes;
+    ParTable tt;
+    ParWorker workers[PAR_MAX_THREADS];
+    int threads;
+    long long maxNodes;
+
+    unsigned int iter, threshold;
+    atomic_uint nextThreshold;    // smallest f that exceeded the threshold
+    atomic_llong pending;         // nodes pushed but not yet fully expanded
+    atomic_llong expandedTotal;
+    _Atomic(const ParNode *) goal;
+    atomic_int failed;
+    pthread_mutex_t lock;         // guards running and idle
+    pthread_cond_t wake;          // running changed
+    pthread_cond_t parked;        // idle went up
+    int running;                  // bumped to start an iteration, -1 to quit
+    int idle;                     // helpers parked between iterations
+};
+
+static void ParSetRunning(ParShared *sh, int running) {
+    pthread_mutex_lock(&sh->lock);
+    sh->running = running;
+    pthread_cond_broadcast(&sh->wake);
+    pthread_mutex_unlock(&sh->lock);
+}
+
+static ParNode *ParAlloc(ParWorker *w) {
+    size_t bytes = (w->sh->nodeBytes + 7) & ~(size_t)7;
+    if (w->chunkLive == 0 || w->chunkUsed + bytes > PAR_ARENA_CHUNK) {
+        if (w->chunkLive == w->chunkCount) {
+            if (w->chunkCount == w->chunkCap) {
+                int cap = w->chunkCap ? w->chunkCap * 2 : 16;
+                char **chunks = realloc(w->chunks, (size_t)cap * sizeof(char *));
+                if (!chunks) return NULL;
+                w->chunks = chunks;
+                w->chunkCap = cap;
+            }
+            char *chunk = malloc(PAR_ARENA_CHUNK);
+            if (!chunk) return NULL;
+            w->chunks[w->chunkCount++] = chunk;
+        }
+        w->chunkLive++;
+        w->chunkUsed = 0;
+    }
+    ParNode *n = (ParNode *)(w->chunks[w->chunkLive - 1] + w->chunkUsed);
+    w->chunkUsed += bytes;
+    return n;
+}
+
+static uint64_t ParNodeHash(const SolverBoard *b, const ParNode *n) {
+    uint64_t h = b->zobPlayer[n->player];
+    for (int i = 0; i < b->nboxes; i++) h ^= b->zobBox[n->boxes[i]];
+    return h;
+}
+
+static void ParAtomicMin(atomic_uint *v, unsigned int x) {
+    unsigned int cur = atomic_load_explicit(v, memory_order_relaxed);
+    while (x < cur && !atomic_compare_exchange_weak_explicit(v, &cur, x,
+            memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+static void ParExpand(ParWorker *w, const ParNode *n) {
+    ParShared *sh = w->sh;
+    const SolverBoard *b = sh->b;
+    int nb = b->nboxes;
+
+    if (SolverBoxesHome(b, n->boxes)) {
+        const ParNode *none = NULL;
+        atomic_compare_exchange_strong(&sh->goal, &none, n);
+        return;
+    }
+    w->expanded++;
+    if (sh->maxNodes > 0 && (w->expanded & 1023) == 0 &&
+        atomic_fetch_add(&sh->expandedTotal, 1024) + 1024 >= sh->maxNodes) {
+        atomic_store(&sh->failed, 1);
+        return;
+    }
+
+    int kids = SolverExpand(w->s, n->boxes, n->player);
+    w->generated += kids;
+    unsigned int g = n->g + 1u;
+    for (int k = 0; k < kids; k++) {
+        const SolverChild *kid = &w->s->kids[k];
+        unsigned int f = g + kid->h;
+        if (f > sh->threshold) { ParAtomicMin(&sh->nextThreshold, f); continue; }
+        if (!ParTableClaim(&sh->tt, kid->hash, sh->iter, g)) continue;
+
+        ParNode *c = ParAlloc(w);
+        if (!c) { atomic_store(&sh->failed, 1); return; }
+        c->parent = n;
+        c->g = (unsigned short)g;
+        c->player = kid->player;
+        c->pushFrom = kid->pushFrom;
+        c->pushDir = kid->pushDir;
+        memcpy(c->boxes, kid->boxes, nb * sizeof(unsigned short));
+        atomic_fetch_add_explicit(&sh->pending, 1, memory_order_relaxed);
+        if (!ParDequePush(&w->deque, c)) {
+            // Deque could not grow: finish the child right here instead
+            ParExpand(w, c);
+            atomic_fetch_sub_explicit(&sh->pending, 1, memory_order_release);
+        }
+    }
+}
+
+// Drain work until the iteration has no pending nodes or a goal turned up
+static void ParRunIteration(ParWorker *w) {
+    ParShared *sh = w->sh;
+    int spins = 0;
+    while (!atomic_load_explicit(&sh->goal, memory_order_relaxed) && !atomic_load(&sh->failed)) {
+        ParNode *n = ParDequeTake(&w->deque);
+        if (n == PAR_EMPTY && sh->threads > 1) {
+            int victim = (int)(SplitMix64(&w->rng) % (uint64_t)sh->threads);
+            if (victim != w->id) n = ParDequeSteal(&sh->workers[victim].deque);
+            if (n == PAR_ABORT) n = PAR_EMPTY;
+        }
+        if (n != PAR_EMPTY) {
+            spins = 0;
+            ParExpand(w, n);
+            atomic_fetch_sub_explicit(&sh->pending, 1, memory_order_release);
+            continue;
+        }
+        if (atomic_load_explicit(&sh->pending, memory_order_acquire) == 0) break;
+        if (++spins > 64) sched_yield();
+    }
+}
+
+static void *ParWorkerMain(void *arg) {
+    ParWorker *w = arg;
+    ParShared *sh = w->sh;
+    int seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&sh->lock);
+        while (sh->running == seen) pthread_cond_wait(&sh->wake, &sh->lock);
+        int r = sh->running;
+        pthread_mutex_unlock(&sh->lock);
+        if (r < 0) break;
+        seen = r;
+        ParRunIteration(w);
+        pthread_mutex_lock(&sh->lock);
+        sh->idle++;
+        pthread_cond_signal(&sh->parked);
+        pthread_mutex_unlock(&sh->lock);
+    }
+    return NULL;
+}
+
+int DefaultThreadCount(void) {
+#if defined(_WIN32)
+    const char *env = getenv("NUMBER_OF_PROCESSORS");
+    int n = env ? atoi(env) : 1;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    if (n > PAR_MAX_THREADS) n = PAR_MAX_THREADS;
+    return n;
+}
+
+// Parallel counterpart of SolveLevel (threads <= 0 = one per core).
+// Solutions are push-optimal like SolveLevel's but may differ in walking.
+int SolveLevelParallel(const Level *lvl, int threads, long long maxNodes, SolveResult *res) {
+    memset(res, 0, sizeof(*res));
+    double t0 = NowSeconds();
+    if (threads <= 0) threads = DefaultThreadCount();
+    if (threads > PAR_MAX_THREADS) threads = PAR_MAX_THREADS;
+
+    ParShared *sh = calloc(1, sizeof(ParShared));
+    if (!sh) { res->solved = -1; return -1; }
+    pthread_mutex_init(&sh->lock, NULL);
+    pthread_cond_init(&sh->wake, NULL);
+    pthread_cond_init(&sh->parked, NULL);
+    int ok = 1, started = 0;
+    ParNode *root = NULL;
+    for (int i = 0; i < threads && ok; i++) {
+        ParWorker *w = &sh->workers[i];
+        w->sh = sh;
+        w->id = i;
+        w->rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+        w->s = calloc(1, sizeof(Solver));
+        ok = w->s && SolverInit(w->s, lvl) && ParDequeInit(&w->deque);
+    }
+    // No boxes, too many or no memory, as in SolveLevelOptions
+    if (!ok) {
+        res->solved = -1;
+        goto cleanup;
+    }
+    const SolverBoard *b = &sh->workers[0].s->b;
+    sh->b = b;
+    sh->threads = threads;
+    sh->maxNodes = maxNodes;
+    sh->nodeBytes = sizeof(ParNode) + b->nboxes * sizeof(unsigned short);
+    unsigned int shardEntries = 1u << (PAR_TT_BITS - PAR_TT_SHARD_BITS);
+    sh->tt.shardMask = shardEntries - 1;
+    for (int i = 0; i < (1 << PAR_TT_SHARD_BITS); i++) {
+        sh->tt.shards[i] = calloc(shardEntries, sizeof(_Atomic(uint64_t)));
+        if (!sh->tt.shards[i]) { res->solved = -1; goto cleanup; }
+    }
+
+    // Root: normalized through worker 0's scratch. It lives outside the
+    // arenas, which start over with every iteration.
+    ParWorker *w0 = &sh->workers[0];
+    root = malloc(sh->nodeBytes);
+    if (!root) { res->solved = -1; goto cleanup; }
+    memset(root, 0, sh->nodeBytes);
+    memcpy(root->boxes, b->startBoxes, b->nboxes * sizeof(unsigned short));
+    for (int i = 1; i < b->nboxes; i++) {   // SolverBoardStart scans in cell order, so already sorted
+        if (root->boxes[i-1] > root->boxes[i]) { res->solved = -1; goto cleanup; }
+    }
+    memset(w0->s->occ, 0, (size_t)b->cells);
+    for (int i = 0; i < b->nboxes; i++) w0->s->occ[root->boxes[i]] = 1;
+    root->player = (unsigned short)SolverReach(w0->s, b->startPlayer);
+
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&sh->workers[i].thread, NULL, ParWorkerMain, &sh->workers[i]) != 0) break;
+        started++;
+    }
+    sh->threads = started + 1;
+
+    sh->threshold = SolverEstimate(w0->s, root->boxes);
+    for (;;) {
+        sh->iter++;
+        if ((sh->iter & 0xFF) == 0) {
+            // 8-bit iteration tags are about to repeat: start from a clean table
+            for (int i = 0; i < (1 << PAR_TT_SHARD_BITS); i++)
+                memset((void *)sh->tt.shards[i], 0, (size_t)shardEntries * sizeof(uint64_t));
+        }
+        // Nodes of the previous iteration are dead: reuse their chunks
+        for (int i = 0; i < sh->threads; i++) {
+            sh->workers[i].chunkLive = 0;
+            sh->workers[i].chunkUsed = 0;
+        }
+        atomic_store(&sh->nextThreshold, UINT_MAX);
+        sh->idle = 0;               // helpers are all parked: nobody else touches it now
+        ParTableClaim(&sh->tt, ParNodeHash(b, root), sh->iter, 0);
+        atomic_store(&sh->pending, 1);
+        ParDequePush(&w0->deque, root);
+        ParSetRunning(sh, sh->running + 1);      // release the helpers
+        ParRunIteration(w0);
+        pthread_mutex_lock(&sh->lock);
+        while (sh->idle < started) pthread_cond_wait(&sh->parked, &sh->lock);
+        pthread_mutex_unlock(&sh->lock);
+        // Drop anything left behind after an early stop
+        for (int i = 0; i < sh->threads; i++) {
+            while (ParDequeTake(&sh->workers[i].deque) != PAR_EMPTY) {}
+        }
+
+        if (atomic_load(&sh->goal) || atomic_load(&sh->failed)) break;
+        unsigned int next = atomic_load(&sh->nextThreshold);
+        if (next == UINT_MAX) break;             // nothing left beyond the bound: unsolvable
+        sh->threshold = next;
+    }
+    ParSetRunning(sh, -1);
+    for (int i = 1; i <= started; i++) pthread_join(sh->workers[i].thread, NULL);
+    started = 0;
+
+    const ParNode *goal = atomic_load(&sh->goal);
+    if (goal) {
+        int pushes = goal->g;
+        unsigned short *from = malloc((size_t)(pushes + 1) * sizeof(unsigned short));
+        unsigned char *dir = malloc((size_t)(pushes + 1));
+        if (from && dir) {
+            int k = pushes;
+            for (const ParNode *n = goal; n->parent; n = n->parent) {
+                k--;
+                from[k] = n->pushFrom;
+                dir[k] = n->pushDir;
+            }
+            res->solved = SolverPathFromPushes(w0->s, from, dir, pushes, res) ? 1 : -1;
+        } else {
+            res->solved = -1;
+        }
+        free(from); free(dir);
+    } else {
+        res->solved = atomic_load(&sh->failed) ? -1 : 0;
+    }
+
+cleanup:
+    if (started > 0) {
+        ParSetRunning(sh, -1);
+        for (int i = 1; i <= started; i++) pthread_join(sh->workers[i].thread, NULL);
+    }
+    res->peakBytes = ((size_t)1 << PAR_TT_BITS) * sizeof(uint64_t);
+    for (int i = 0; i < (1 << PAR_TT_SHARD_BITS); i++) free(sh->tt.shards[i]);
+    for (int i = 0; i < threads; i++) {
+        ParWorker *w = &sh->workers[i];
+        res->expanded += w->expanded;
+        res->generated += w->generated;
+        res->peakBytes += (size_t)w->chunkCount * PAR_ARENA_CHUNK;
+        for (int c = 0; c < w->chunkCount; c++) free(w->chunks[c]);
+        free(w->chunks);
+        if (w->s) {
+            ParDequeFree(&w->deque);
+            SolverFree(w->s);
+        }
+    }
+    pthread_cond_destroy(&sh->parked);
+    pthread_cond_destroy(&sh->wake);
+    pthread_mutex_destroy(&sh->lock);
+    free(sh);
+    free(root);
+    res->seconds = NowSeconds() - t0;
+    return res->solved;
+}
+
+// `my_game --bench-parallel [maxThreads] [repeat] [pack.xsb] [maxNodes]`:
+// solve every level of the pack (the bundled level without one) with 1, 2,
+// 4, ... threads. Each row sums the pack: wall time, its speedup over one
+// thread, nodes expanded and the nodes/sec speedup. Work stealing changes the
+// search order, so the node count shows how much of a time speedup is
+// parallelism and how much is a luckier (or unluckier) search. Levels one
+// thread cannot solve within maxNodes (default 2M) are left out.
+static int RunParallelBenchCli(int maxThreads, int repeat, const char *pack, long long maxNodes) {
+    if (maxThreads <= 0) maxThreads = DefaultThreadCount();
+    if (repeat < 1) repeat = 1;
+    if (maxNodes <= 0) maxNodes = 2000000;
+    PackReader pr;
+    if (pack && !PackOpen(&pr, pack)) { fprintf(stderr, "cannot open %s\n", pack); return 1; }
+    Level **levels = NULL;
+    int *pushes = NULL;
+    int count = 0, skipped = 0, code = 0;
+    Level *lvl = calloc(1, sizeof(Level));
+    LevelStatus st = LEVEL_OK;
+    for (int index = 1; lvl && (pack ? PackNext(&pr, lvl, &st) : index == 1); index++) {
+        if (!pack) st = LoadLevel(lvl, levelMap);
+        if (st != LEVEL_OK) continue;
+        SolveResult res;
+        SolveLevelParallel(lvl, 1, maxNodes, &res);
+        free(res.steps);
+        Level **grownLevels = realloc(levels, (size_t)(count + 1) * sizeof(Level *));
+        if (grownLevels) levels = grownLevels;
+        int *grownPushes = grownLevels ? realloc(pushes, (size_t)(count + 1) * sizeof(int)) : NULL;
+        if (grownPushes) pushes = grownPushes;
+        if (res.solved != 1 || !grownPushes) { skipped++; continue; }
+        pushes[count] = res.pushes;
+        levels[count++] = lvl;
+        lvl = calloc(1, sizeof(Level));
+    }
+    if (pack) PackClose(&pr);
+    if (lvl) { LevelFree(lvl); free(lvl); }
+    printf("# %d levels (%d left out: unsolved within %lld nodes)\n", count, skipped, maxNodes);
+    if (!count) { free(levels); free(pushes); return 1; }
+
+    double baseTime = 0, baseRate = 0;
+    long long baseNodes = 0;
+    printf("threads  time_ms  speedup     expanded  nodes_vs_1  nodes/sec  rate_speedup\n");
+    for (int t = 1; t <= maxThreads; t = (t < maxThreads && t * 2 > maxThreads) ? maxThreads : t * 2) {
+        double total = 0;
+        long long expanded = 0;
+        for (int r = 0; r < repeat && !code; r++) {
+            for (int l = 0; l < count; l++) {
+                SolveResult res;
+                SolveLevelParallel(levels[l], t, 0, &res);
+                free(res.steps);
+                total += res.seconds;
+                expanded += res.expanded;
+                if (res.solved != 1 || res.pushes != pushes[l]) {
+                    printf("%7d  level %d: %s\n", t, l + 1, res.solved == 1 ? "push count differs" : "not solved");
+                    code = 2;
+                    break;
+                }
+            }
+        }
+        if (code) break;
+        double avg = total / repeat, rate = expanded / total;
+        long long nodes = expanded / repeat;
+        if (t == 1) { baseTime = avg; baseRate = rate; baseNodes = nodes; }
+        printf("%7d  %7.1f  %6.2fx  %11lld  %9.2fx  %9.0f  %11.2fx\n", t, avg * 1e3, baseTime / avg,
+               nodes, (double)nodes / baseNodes, rate, rate / baseRate);
+        if (t == maxThreads) break;
+    }
+    for (int l = 0; l < count; l++) { LevelFree(levels[l]); free(levels[l]); }
+    free(levels);
+    free(pushes);
+    return code;
+}
+// ========================================================================
+
+// =================== [ Batch pack validation ] ===================
+// `my_game --validate pack.xsb [threads] [maxNodes] [heuristic]`: stream a
+// pack, solve every level on a pool of worker threads and print one
+// tab-separated line per level (in completion order) plus a summary. The exit
+// code is 0 only when every level loaded and was solved, so it can gate a release.
+
+#define VALIDATE_QUEUE 64
+
+typedef struct {
+    int index;
+    long line;
+    char title[128];
+    LevelStatus status;
+    Level *lvl;
+} ValidateJob;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty, notFull;
+    ValidateJob jobs[VALIDATE_QUEUE];
+    int head, count, closed;
+    long long maxNodes;
+    Heuristic heuristic;
+    int solved, unsolvable, gaveUp, invalid;
+} ValidateQueue;
+
+static void *ValidateWorker(void *arg) {
+    ValidateQueue *q = arg;
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (q->count == 0 && !q->closed) pthread_cond_wait(&q->notEmpty, &q->lock);
+        if (q->count == 0) { pthread_mutex_unlock(&q->lock); break; }
+        ValidateJob job = q->jobs[q->head];
+        q->head = (q->head + 1) % VALIDATE_QUEUE;
+        q->count--;
+        pthread_cond_signal(&q->notFull);
+        pthread_mutex_unlock(&q->lock);
+
+        SolveResult res = {0};
+        const char *verdict;
+        if (job.status != LEVEL_OK) {
+            verdict = LevelStatusText(job.status);
+        } else {
+            SolveLevelWith(job.lvl, q->heuristic, q->maxNodes, &res);
+            verdict = res.solved == 1 ? "solved" : res.solved == 0 ? "unsolvable" : "gave-up";
+        }
+        free(res.steps);
+        LevelFree(job.lvl);
+        free(job.lvl);
+
+        pthread_mutex_lock(&q->lock);
+        if (job.status != LEVEL_OK) q->invalid++;
+        else if (res.solved == 1) q->solved++;
+        else if (res.solved == 0) q->unsolvable++;
+        else q->gaveUp++;
+        printf("%d\t%ld\t%s\t%d\t%d\t%lld\t%.2f\t%s\n", job.index, job.line, verdict,
+               res.pushes, res.moves, res.expanded, res.seconds * 1e3, job.title);
+        pthread_mutex_unlock(&q->lock);
+    }
+    return NULL;
+}
+
+static int RunValidateCli(const char *path, int threads, long long maxNodes, const char *heuristic) {
+    Heuristic h = heuristic ? HeuristicParse(heuristic) : HEURISTIC_NEAREST;
+    if (h == HEURISTIC_COUNT) { fprintf(stderr, "unknown heuristic %s\n", heuristic); return 1; }
+    PackReader pr;
+    if (!PackOpen(&pr, path)) { fprintf(stderr, "cannot open %s\n", path); return 1; }
+    if (threads <= 0) threads = DefaultThreadCount();
+    if (maxNodes <= 0) maxNodes = 2000000;
+
+    ValidateQueue *q = calloc(1, sizeof(ValidateQueue));
+    pthread_t *tids = calloc((size_t)threads, sizeof(pthread_t));
+    if (!q || !tids) { free(q); free(tids); PackClose(&pr); return 1; }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+    q->maxNodes = maxNodes;
+    q->heuristic = h;
+
+    double t0 = NowSeconds();
+    printf("level\tline\tresult\tpushes\tmoves\tnodes\tms\ttitle\n");
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, ValidateWorker, q) != 0) break;
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "cannot start worker threads\n");
+        free(tids); free(q); PackClose(&pr);
+        return 1;
+    }
+
+    int levels = 0;
+    for (;;) {
+        Level *lvl = calloc(1, sizeof(Level));
+        LevelStatus st;
+        if (!lvl || !PackNext(&pr, lvl, &st)) { if (lvl) LevelFree(lvl); free(lvl); break; }
+        ValidateJob job = { pr.index, pr.firstLine, {0}, st, lvl };
+        snprintf(job.title, sizeof(job.title), "%s", pr.title);
+        levels++;
+
+        pthread_mutex_lock(&q->lock);
+        while (q->count == VALIDATE_QUEUE) pthread_cond_wait(&q->notFull, &q->lock);
+        q->jobs[(q->head + q->count) % VALIDATE_QUEUE] = job;
+        q->count++;
+        pthread_cond_signal(&q->notEmpty);
+        pthread_mutex_unlock(&q->lock);
+    }
+    PackClose(&pr);
+
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+
+    double secs = NowSeconds() - t0;
+    printf("# %d levels in %.2f s on %d threads: %d solved, %d unsolvable, %d gave up, %d invalid\n",
+           levels, secs, started, q->solved, q->unsolvable, q->gaveUp, q->invalid);
+    int allGood = levels > 0 && q->solved == levels;
+
+    pthread_cond_destroy(&q->notFull);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_mutex_destroy(&q->lock);
+    free(tids);
+    free(q);
+    return allGood ? 0 : 2;
+}
+// ========================================================================
+
+// =================== [ Bulk solution verification ] ===================
+// `my_game --verify pack.xsb solutions.txt [threads]`: replay LURD solutions
+// against a pack without a window. Each solutions line is "<level> <lurd>"
+// (level numbers as printed by --validate); blank lines and lines starting
+// with ';' or '#' are skipped. Lines are handed to a worker pool in batches,
+// every worker replays on its own scratch copy of the level and prints one
+// tab-separated line per solution (line, level, result, moves, pushes,
+// first illegal move). The exit code is 0 only when every solution solves.
+
+#define VERIFY_BATCH 4096         // solution lines handed to a worker at once
+#define VERIFY_QUEUE 8
+
+typedef struct {
+    char *text;                   // the batch's lines, each NUL-terminated
+    size_t len, cap;
+    long lineNo[VERIFY_BATCH];
+    size_t offset[VERIFY_BATCH];
+    int count;
+} VerifyBatch;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty, notFull;
+    VerifyBatch *batches[VERIFY_QUEUE];
+    int head, count, closed;
+
+    Level **levels;               // the whole pack, loaded once; NULL where a level failed to load
+    int levelCount;
+
+    long long counts[REPLAY_BAD_CHAR + 2];   // per ReplayStatus, plus "no-level"
+    long long moves, pushes;
+} VerifyQueue;
+
+static int VerifyAppend(char **buf, size_t *len, size_t *cap, const char *s, size_t n) {
+    if (*len + n + 1 > *cap) {
+        size_t c = *cap ? *cap : 4096;
+        while (c < *len + n + 1) c *= 2;
+        char *b = realloc(*buf, c);
+        if (!b) return 0;
+        *buf = b;
+        *cap = c;
+    }
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    (*buf)[*len] = 0;
+    return 1;
+}
+
+static void *VerifyWorker(void *arg) {
+    VerifyQueue *q = arg;
+    Level *work = calloc(1, sizeof(Level));
+    char *out = NULL;
+    size_t outLen = 0, outCap = 0;
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (q->count == 0 && !q->closed) pthread_cond_wait(&q->notEmpty, &q->lock);
+        if (q->count == 0) { pthread_mutex_unlock(&q->lock); break; }
+        VerifyBatch *b = q->batches[q->head];
+        q->head = (q->head + 1) % VERIFY_QUEUE;
+        q->count--;
+        pthread_cond_signal(&q->notFull);
+        pthread_mutex_unlock(&q->lock);
+
+        long long counts[REPLAY_BAD_CHAR + 2] = {0};
+        long long moves = 0, pushes = 0;
+        outLen = 0;
+        for (int i = 0; i < b->count; i++) {
+            char *line = b->text + b->offset[i];
+            char *lurd;
+            long level = strtol(line, &lurd, 10);
+            ReplayResult res = {0};
+            const char *verdict;
+            // Scratch copy without the history: replay never touches the move log
+            bool found = work && lurd != line && level >= 1 && level <= q->levelCount && q->levels[level-1];
+            if (!found || !LevelCopyBoard(work, q->levels[level-1])) {
+                verdict = "no-level";
+                counts[REPLAY_BAD_CHAR + 1]++;
+            } else {
+                ReplayLurd(work, lurd, strlen(lurd), &res);
+                verdict = ReplayStatusText(res.status);
+                counts[res.status]++;
+                moves += res.moves;
+                pushes += res.pushes;
+            }
+            char row[96];
+            int n = snprintf(row, sizeof(row), "%ld\t%ld\t%s\t%d\t%d\t%d\n", b->lineNo[i], level, verdict,
+                             res.moves, res.pushes, res.firstIllegal);
+            VerifyAppend(&out, &outLen, &outCap, row, (size_t)n);
+        }
+        free(b->text);
+        free(b);
+
+        pthread_mutex_lock(&q->lock);
+        if (outLen) fwrite(out, 1, outLen, stdout);
+        for (int k = 0; k < REPLAY_BAD_CHAR + 2; k++) q->counts[k] += counts[k];
+        q->moves += moves;
+        q->pushes += pushes;
+        pthread_mutex_unlock(&q->lock);
+    }
+    free(out);
+    if (work) LevelFree(work);
+    free(work);
+    return NULL;
+}
+
+static void VerifyEnqueue(VerifyQueue *q, VerifyBatch *b) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == VERIFY_QUEUE) pthread_cond_wait(&q->notFull, &q->lock);
+    q->batches[(q->head + q->count) % VERIFY_QUEUE] = b;
+    q->count++;
+    pthread_cond_signal(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int RunVerifyCli(const char *packPath, const char *solPath, int threads) {
+    if (threads <= 0) threads = DefaultThreadCount();
+
+    // Load the whole pack up front; solutions may refer to levels in any order
+    PackReader pr;
+    if (!PackOpen(&pr, packPath)) { fprintf(stderr, "cannot open %s\n", packPath); return 1; }
+    VerifyQueue *q = calloc(1, sizeof(VerifyQueue));
+    if (!q) { PackClose(&pr); return 1; }
+    int levelCap = 0;
+    for (;;) {
+        Level *lvl = calloc(1, sizeof(Level));
+        LevelStatus st;
+        if (!lvl || !PackNext(&pr, lvl, &st)) { if (lvl) LevelFree(lvl); free(lvl); break; }
+        if (st != LEVEL_OK) { LevelFree(lvl); free(lvl); lvl = NULL; }
+        if (q->levelCount == levelCap) {
+            levelCap = levelCap ? levelCap * 2 : 64;
+            Level **levels = realloc(q->levels, (size_t)levelCap * sizeof(Level *));
+            if (!levels) { if (lvl) LevelFree(lvl); free(lvl); break; }
+            q->levels = levels;
+        }
+        q->levels[q->levelCount++] = lvl;
+    }
+    PackClose(&pr);
+
+    int status = 1;
+    pthread_t *tids = calloc((size_t)threads, sizeof(pthread_t));
+    if (!tids || !PackOpen(&pr, solPath)) {
+        if (tids) fprintf(stderr, "cannot open %s\n", solPath);
+        goto done;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+
+    double t0 = NowSeconds();
+    printf("line\tlevel\tresult\tmoves\tpushes\tfirst_illegal\n");
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, VerifyWorker, q) != 0) break;
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "cannot start worker threads\n");
+        PackClose(&pr);
+        goto destroy;
+    }
+
+    // Stream the solutions file (lines may be arbitrarily long) in batches
+    long long solutions = 0;
+    bool outOfMemory = false;
+    VerifyBatch *b = NULL;
+    while (PackReadLine(&pr)) {
+        const char *line = pr.line;
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == 0 || *line == '\n' || *line == '\r' || *line == ';' || *line == '#') continue;
+        if (!b && !(b = calloc(1, sizeof(VerifyBatch)))) { outOfMemory = true; break; }
+        b->lineNo[b->count] = pr.lineNo;
+        b->offset[b->count] = b->len;
+        if (!VerifyAppend(&b->text, &b->len, &b->cap, line, strlen(line) + 1)) {
+            // Its lines were counted but will not be checked: the run fails
+            free(b->text);
+            free(b);
+            b = NULL;
+            outOfMemory = true;
+            break;
+        }
+        b->count++;
+        solutions++;
+        if (b->count == VERIFY_BATCH) { VerifyEnqueue(q, b); b = NULL; }
+    }
+    if (b && b->count) VerifyEnqueue(q, b);
+    else if (b) { free(b->text); free(b); }
+    PackClose(&pr);
+
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+
+    double secs = NowSeconds() - t0;
+    printf("# %lld solutions for %d levels in %.2f s on %d threads (%.0f solutions/sec, %.0f moves/sec): "
+           "%lld solved, %lld unsolved, %lld illegal, %lld bad-char, %lld no-level\n",
+           solutions, q->levelCount, secs, started, secs > 0 ? solutions / secs : 0.0, secs > 0 ? q->moves / secs : 0.0,
+           q->counts[REPLAY_SOLVED], q->counts[REPLAY_UNSOLVED], q->counts[REPLAY_ILLEGAL],
+           q->counts[REPLAY_BAD_CHAR], q->counts[REPLAY_BAD_CHAR + 1]);
+    status = solutions > 0 && q->counts[REPLAY_SOLVED] == solutions ? 0 : 2;
+    if (outOfMemory) { fprintf(stderr, "out of memory reading %s\n", solPath); status = 1; }
+
+destroy:
+    pthread_cond_destroy(&q->notFull);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_mutex_destroy(&q->lock);
+done:
+    free(tids);
+    for (int i = 0; i < q->levelCount; i++) {
+        if (q->levels[i]) LevelFree(q->levels[i]);
+        free(q->levels[i]);
+    }
+    free(q->levels);
+    free(q);
+    return status;
+}
+// ========================================================================
+
+// =================== [ Counter self-check ] ===================
+// `my_game --check-counters [pack.xsb] [sequences] [length]`: play random
+// move/undo/redo/jump sequences and compare the incremental counters and hash
+// with a full rescan after every step. Exit code 0 means they never disagreed.
+
+static int CheckLevelCounters(Level *lvl, int sequences, int length, uint64_t *rng) {
+    Level *start = calloc(1, sizeof(Level));
+    if (!start || !LevelCopy(start, lvl)) { free(start); return 0; }
+    int ok = 1;
+    for (int s = 0; s < sequences && ok; s++) {
+        if (!LevelCopy(lvl, start)) { ok = 0; break; }
+        for (int i = 0; i < length; i++) {
+            uint64_t r = SplitMix64(rng);
+            if (r % 8 < 2) UndoMove(lvl);
+            else if (r % 8 == 2) RedoMove(lvl);
+            else if (r % 64 == 3) JumpToMove(lvl, (int)((r >> 16) % (uint64_t)(lvl->log.count + 1)));
+            else { int d = (int)(r >> 8) & 3; TryMove(lvl, dirDX[d], dirDY[d]); }
+
+            int off, on;
+            uint64_t hash;
+            LevelRecount(lvl, &off, &on, &hash);
+            bool solved = true;
+            for (int w = 0; w < lvl->words; w++) if (lvl->boxes[w] & ~lvl->targets[w]) solved = false;
+            if (off != lvl->boxesOff || on != lvl->boxesOn || hash != lvl->hash || solved != LevelSolved(lvl)) {
+                printf("  mismatch after step %d of sequence %d: off %d/%d on %d/%d hash %s\n",
+                       i, s, lvl->boxesOff, off, lvl->boxesOn, on, hash == lvl->hash ? "ok" : "differs");
+                ok = 0;
+                break;
+            }
+        }
+    }
+    LevelFree(start);
+    free(start);
+    return ok;
+}
+
+static int RunCheckCountersCli(const char *pack, int sequences, int length) {
+    if (sequences < 1) sequences = 200;
+    if (length < 1) length = 500;
+    Level *lvl = calloc(1, sizeof(Level));
+    if (!lvl) return 1;
+    uint64_t rng = 12345;
+    int levels = 0, failed = 0;
+    if (pack) {
+        PackReader pr;
+        LevelStatus st;
+        if (!PackOpen(&pr, pack)) { fprintf(stderr, "cannot open %s\n", pack); free(lvl); return 1; }
+        while (PackNext(&pr, lvl, &st)) {
+            if (st != LEVEL_OK) continue;
+            levels++;
+            if (!CheckLevelCounters(lvl, sequences, length, &rng)) { printf("level %d: FAILED\n", pr.index); failed++; }
+        }
+        PackClose(&pr);
+    } else {
+        LoadLevel(lvl, levelMap);
+        levels = 1;
+        if (!CheckLevelCounters(lvl, sequences, length, &rng)) { printf("level 1: FAILED\n"); failed++; }
+    }
+    LevelFree(lvl);
+    free(lvl);
+    printf("%d levels, %d x %d random steps each: %s\n", levels, sequences, length, failed ? "MISMATCH" : "counters match rescan");
+    return failed ? 2 : 0;
+}
+// ========================================================================
+
+// =================== [ Batched environments ] ===================
+// Many games stepped together for training agents and fuzzing. Each field of
+// the game state is one array indexed by environment, and a step reads only
+// the player cell, two entries of a neighbour table and two box bits, without
+// branches, so a batch runs much faster than TryMove on whole Levels. Steps follow
+// LevelStepLayers exactly; --bench-envs replays the same actions through
+// TryMove and compares before it times anything.
+
+#define ENV_ALIGN 64            // every per-environment array starts on a cache line
+
+// Step tables of a board: neighbours, where a wall or the edge leaves a cell
+// pointing at itself, and the Zobrist keys of every cell
+static bool EnvBoardTables(EnvBoard *bd) {
+    const Level *lvl = &bd->level;
+    int cells = lvl->w * lvl->h;
+    bd->next = malloc((size_t)cells * 4 * sizeof(int32_t));
+    bd->zobrist = malloc((size_t)cells * 2 * sizeof(uint64_t));
+    if (!bd->next || !bd->zobrist) return false;
+    for (int c = 0; c < cells; c++) {
+        int x = c % lvl->w, y = c / lvl->w;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dirDX[d], ny = y + dirDY[d];
+            bool open = nx >= 0 && ny >= 0 && nx < lvl->w && ny < lvl->h && !BB_TEST(lvl->walls, ny * lvl->w + nx);
+            bd->next[c * 4 + d] = open ? ny * lvl->w + nx : c;
+        }
+        bd->zobrist[c * 2] = ZobristKey(c, 0);
+        bd->zobrist[c * 2 + 1] = ZobristKey(c, 1);
+    }
+    return true;
+}
+
+// Next aligned array of n elements of `size` bytes from the arena cursor
+static void *EnvCarve(char **cursor, size_t n, size_t size) {
+    void *p = *cursor;
+    *cursor += (n * size + ENV_ALIGN - 1) / ENV_ALIGN * ENV_ALIGN;
+    return p;
+}
+
+// Restart environment e from the start of its board
+static void EnvResetOne(EnvBatch *eb, int e) {
+    const Level *start = &eb->boards[eb->board[e]].level;
+    uint64_t *bx = eb->boxes + (size_t)e * eb->words;
+    uint64_t dead = 0;
+    for (int i = 0; i < start->words; i++) {
+        bx[i] = start->boxes[i];
+        dead |= bx[i] & start->dead[i];
+    }
+    for (int i = start->words; i < eb->words; i++) bx[i] = 0;
+    eb->player[e] = start->py * start->w + start->px;
+    eb->boxesOff[e] = start->boxesOff;
+    eb->hash[e] = start->hash;
+    eb->moveCount[e] = eb->pushCount[e] = 0;
+    eb->done[e] = start->boxesOff == 0;
+    eb->stuck[e] = dead != 0;
+}
+
+// count environments over levelCount boards; environment e starts on board
+// e % levelCount, from the position each level is in now (history is not
+// kept). False when a level is not loaded or memory runs out.
+bool EnvBatchInit(EnvBatch *eb, const Level *const *levels, int levelCount, int count) {
+    memset(eb, 0, sizeof(*eb));
+    if (levelCount < 1 || count < 1) return false;
+    eb->boards = calloc((size_t)levelCount, sizeof(EnvBoard));
+    if (!eb->boards) return false;
+    eb->boardCount = levelCount;
+    for (int b = 0; b < levelCount; b++) {
+        EnvBoard *bd = &eb->boards[b];
+        if (!levels[b]->arena || !LevelCopyBoard(&bd->level, levels[b]) || !EnvBoardTables(bd)) {
+            EnvBatchFree(eb);
+            return false;
+        }
+        if (levels[b]->words > eb->words) eb->words = levels[b]->words;
+    }
+
+    size_t n = (size_t)count, bytes = 0;
+    size_t sizes[] = { n * eb->words * 8, n * 8, n * 4, n * 4, n * 4, n * 4, n * 4, n, n };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) bytes += (sizes[i] + ENV_ALIGN - 1) / ENV_ALIGN * ENV_ALIGN;
+    eb->arena = malloc(bytes + ENV_ALIGN);
+    if (!eb->arena) { EnvBatchFree(eb); return false; }
+    char *cursor = (char *)(((uintptr_t)eb->arena + ENV_ALIGN - 1) & ~(uintptr_t)(ENV_ALIGN - 1));
+    eb->boxes = EnvCarve(&cursor, n * eb->words, sizeof(uint64_t));
+    eb->hash = EnvCarve(&cursor, n, sizeof(uint64_t));
+    eb->board = EnvCarve(&cursor, n, sizeof(int32_t));
+    eb->player = EnvCarve(&cursor, n, sizeof(int32_t));
+    eb->boxesOff = EnvCarve(&cursor, n, sizeof(int32_t));
+    eb->moveCount = EnvCarve(&cursor, n, sizeof(int32_t));
+    eb->pushCount = EnvCarve(&cursor, n, sizeof(int32_t));
+    eb->done = EnvCarve(&cursor, n, 1);
+    eb->stuck = EnvCarve(&cursor, n, 1);
+    eb->count = count;
+    for (int e = 0; e < count; e++) {
+        eb->board[e] = e % levelCount;
+        EnvResetOne(eb, e);
+    }
+    return true;
+}
+
+void EnvBatchFree(EnvBatch *eb) {
+    for (int b = 0; b < eb->boardCount; b++) {
+        LevelFree(&eb->boards[b].level);
+        free(eb->boards[b].next);
+        free(eb->boards[b].zobrist);
+    }
+    free(eb->boards);
+    free(eb->arena);
+    memset(eb, 0, sizeof(*eb));
+}
+
+// Restart environments begin..end-1 where mask is set (NULL = all of them).
+// EnvBatchReset(eb, 0, eb->count, eb->done) starts finished games over.
+void EnvBatchReset(EnvBatch *eb, int begin, int end, const uint8_t *mask) {
+    for (int e = begin; e < end; e++)
+        if (!mask || mask[e]) EnvResetOne(eb, e);
+}
+
+// Apply actions[e] to environments begin..end-1: a direction 0-3 in dirDX/dirDY
+// order, anything else stands still. result[e] (may be NULL) gets the move byte
+// as TryMove would record it, or -1 when nothing moved. Ranges that do not
+// overlap can be stepped from different threads. Returns how many of the
+// range are done.
+int EnvBatchStep(EnvBatch *eb, int begin, int end, const uint8_t *actions, int8_t *result) {
+    // Locals, not eb->: the byte-sized stores below may alias anything, which
+    // would otherwise reload every array pointer on every environment
+    const EnvBoard *boards = eb->boards;
+    const int32_t *board = eb->board;
+    int32_t *player = eb->player, *boxesOff = eb->boxesOff, *moveCount = eb->moveCount, *pushCount = eb->pushCount;
+    uint64_t *hash = eb->hash, *boxes = eb->boxes;
+    uint8_t *stuck = eb->stuck;
+    size_t words = (size_t)eb->words;
+    // Branch-free: random actions make every test a coin flip for the branch
+    // predictor, so each outcome is computed and masked in instead
+    for (int e = begin; e < end; e++) {
+        const EnvBoard *bd = &boards[board[e]];
+        const int32_t *next = bd->next;
+        const uint64_t *targets = bd->level.targets, *dead = bd->level.dead, *zobrist = bd->zobrist;
+        uint64_t *bx = boxes + (size_t)e * words;
+        unsigned a = actions[e], d = a & 3;
+        int c = player[e];
+        int n = next[c * 4 + d];
+        int to = next[n * 4 + d];           // n itself when blocked, and n holds the box
+        unsigned open = (a < 4) & (n != c);
+        unsigned box = (unsigned)BB_TEST(bx, n), boxTo = (unsigned)BB_TEST(bx, to);
+        unsigned push = open & box & !boxTo;
+        unsigned move = open & !(box & boxTo);
+        uint64_t pushMask = 0 - (uint64_t)push, moveMask = 0 - (uint64_t)move;
+
+        bx[n >> 6] ^= pushMask & (uint64_t)1 << (n & 63);
+        bx[to >> 6] ^= pushMask & (uint64_t)1 << (to & 63);
+        boxesOff[e] += (int)push * ((int)BB_TEST(targets, n) - (int)BB_TEST(targets, to));
+        hash[e] ^= (pushMask & (zobrist[n * 2] ^ zobrist[to * 2])) ^ (moveMask & (zobrist[c * 2 + 1] ^ zobrist[n * 2 + 1]));
+        player[e] = c + ((n - c) & (int)moveMask);
+        moveCount[e] += (int)move;
+        pushCount[e] += (int)push;
+        stuck[e] |= (uint8_t)(push & BB_TEST(dead, to));
+        if (result) result[e] = (int8_t)(move ? (int)(d | push * MOVE_PUSH) : -1);
+    }
+    // Separate pass: branch-free over plain arrays, so it vectorizes
+    uint8_t *doneOut = eb->done;
+    int done = 0;
+    for (int e = begin; e < end; e++) {
+        doneOut[e] = boxesOff[e] == 0;
+        done += boxesOff[e] == 0;
+    }
+    return done;
+}
+
+// Take back move byte m (as EnvBatchStep returned it, the last one made) on
+// environment e. Callers that allow undo keep the moves themselves.
+void EnvBatchUndo(EnvBatch *eb, int e, int m) {
+    if (m < 0) return;
+    const EnvBoard *bd = &eb->boards[eb->board[e]];
+    const Level *start = &bd->level;
+    uint64_t *bx = eb->boxes + (size_t)e * eb->words;
+    int d = m & MOVE_DIR_MASK, c = eb->player[e];
+    int from = bd->next[c * 4 + (d ^ 1)];      // the player came from there, so it is open
+    if (m & MOVE_PUSH) {
+        int box = bd->next[c * 4 + d];
+        BB_CLEAR(bx, box);
+        BB_SET(bx, c);
+        eb->boxesOff[e] += (int)BB_TEST(start->targets, box) - (int)BB_TEST(start->targets, c);
+        eb->hash[e] ^= bd->zobrist[box * 2] ^ bd->zobrist[c * 2];
+        eb->pushCount[e]--;
+        // Pulling a box back can take it off a dead square
+        uint64_t dead = 0;
+        for (int i = 0; i < start->words; i++) dead |= bx[i] & start->dead[i];
+        eb->stuck[e] = dead != 0;
+    }
+    eb->hash[e] ^= bd->zobrist[c * 2 + 1] ^ bd->zobrist[from * 2 + 1];
+    eb->player[e] = from;
+    eb->moveCount[e]--;
+    eb->done[e] = eb->boxesOff[e] == 0;
+}
+
+// Copy environment e into lvl (zeroed or loaded) to draw, solve or check it.
+// The history is empty; false when out of memory.
+bool EnvBatchGet(const EnvBatch *eb, int e, Level *lvl) {
+    const Level *start = &eb->boards[eb->board[e]].level;
+    if (!LevelCopyBoard(lvl, start)) return false;
+    memcpy(lvl->boxes, eb->boxes + (size_t)e * eb->words, (size_t)start->words * sizeof(uint64_t));
+    lvl->px = eb->player[e] % start->w;
+    lvl->py = eb->player[e] / start->w;
+    LevelRecount(lvl, &lvl->boxesOff, &lvl->boxesOn, &lvl->hash);
+    lvl->deadlock = LevelDeadlock(lvl);
+    return true;
+}
+
+// Step a batch and one Level per environment through TryMove and UndoMove
+// with the same random actions (and restarts) and compare them after every step
+static bool EnvCheckAgainstTryMove(const Level *const *levels, int levelCount, int count, int steps, uint64_t *rng) {
+    EnvBatch eb;
+    if (!EnvBatchInit(&eb, levels, levelCount, count)) return false;
+    Level *ref = calloc((size_t)count, sizeof(Level));
+    uint8_t *actions = malloc((size_t)count);
+    int8_t *result = malloc((size_t)count);
+    bool ok = ref && actions && result;
+    for (int e = 0; e < count && ok; e++) ok = LevelCopyBoard(&ref[e], levels[e % levelCount]);
+    for (int s = 0; s < steps && ok; s++) {
+        for (int e = 0; e < count; e++) actions[e] = (uint8_t)(SplitMix64(rng) % 6);   // 4 = stand still, 5 = undo
+        EnvBatchStep(&eb, 0, count, actions, result);
+        for (int e = 0; e < count && ok; e++) {
+            Level *lvl = &ref[e];
+            int before = lvl->moveCount, d = actions[e];
+            if (d == 5 && lvl->log.pos > 0) {
+                EnvBatchUndo(&eb, e, lvl->log.moves[lvl->log.pos - 1]);
+                UndoMove(lvl);
+                result[e] = -1;
+            }
+            if (d < 4) TryMove(lvl, dirDX[d], dirDY[d]);
+            else TryMove(lvl, 0, 0);
+            int m = lvl->moveCount > before ? lvl->log.moves[lvl->moveCount - 1] : -1;
+            bool same = eb.player[e] == lvl->py * lvl->w + lvl->px && eb.boxesOff[e] == lvl->boxesOff &&
+                        eb.hash[e] == lvl->hash && eb.moveCount[e] == lvl->moveCount &&
+                        result[e] == m && (eb.done[e] != 0) == LevelSolved(lvl) &&
+                        (!eb.stuck[e] || lvl->deadlock != DEADLOCK_NONE) &&
+                        memcmp(eb.boxes + (size_t)e * eb.words, lvl->boxes, (size_t)lvl->words * sizeof(uint64_t)) == 0;
+            if (!same) {
+                printf("  environment %d differs from TryMove after step %d\n", e, s);
+                ok = false;
+            }
+            // Restart both sides of finished games, and a few others at random
+            if (eb.done[e] || SplitMix64(rng) % 512 == 0) {
+                EnvBatchReset(&eb, e, e + 1, NULL);
+                ok = ok && LevelCopyBoard(lvl, levels[e % levelCount]);
+            }
+        }
+    }
+    for (int e = 0; ref && e < count; e++) LevelFree(&ref[e]);
+    free(ref);
+    free(actions);
+    free(result);
+    EnvBatchFree(&eb);
+    return ok;
+}
+
+typedef struct {
+    EnvBatch *eb;
+    int begin, end;
+    double seconds;
+    uint8_t *actions;           // shared array; this worker writes only its range
+    long long steps;
+    pthread_t thread;
+} EnvBenchWorker;
+
+// Random actions, step, restart finished games, until the time is up
+static void *EnvBenchMain(void *arg) {
+    EnvBenchWorker *w = arg;
+    int begin = w->begin, end = w->end;
+    uint8_t *actions = w->actions;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL ^ (uint64_t)begin;
+    double t0 = NowSeconds();
+    long long steps = 0;
+    do {
+        for (int round = 0; round < 64; round++) {
+            uint64_t r = 0;
+            for (int e = begin; e < end; e++) {
+                if (((e - begin) & 31) == 0) r = SplitMix64(&rng);
+                actions[e] = (uint8_t)(r & 3);
+                r >>= 2;
+            }
+            if (EnvBatchStep(w->eb, begin, end, actions, NULL))
+                EnvBatchReset(w->eb, begin, end, w->eb->done);
+            steps += end - begin;
+        }
+    } while (NowSeconds() - t0 < w->seconds);
+    w->steps = steps;
+    return NULL;
+}
+
+// `my_game --bench-envs [envs] [seconds] [pack.xsb]`: check the batch against
+// TryMove and UndoMove, then print environment steps per second with 1, 2, 4, ... threads
+// next to TryMove on a single Level.
+static int RunEnvBenchCli(int count, double seconds, const char *pack) {
+    if (count < 1) count = 4096;
+    if (seconds <= 0) seconds = 1;
+    Level **levels = NULL;
+    int levelCount = 0;
+    if (pack) {
+        PackReader pr;
+        LevelStatus st;
+        if (!PackOpen(&pr, pack)) { fprintf(stderr, "cannot open %s\n", pack); return 1; }
+        Level *lvl = calloc(1, sizeof(Level));
+        while (lvl && PackNext(&pr, lvl, &st)) {
+            if (st != LEVEL_OK) continue;
+            Level **grown = realloc(levels, (size_t)(levelCount + 1) * sizeof(Level *));
+            Level *copy = calloc(1, sizeof(Level));
+            if (grown) levels = grown;
+            if (!grown || !copy || !LevelCopyBoard(copy, lvl)) { free(copy); break; }
+            levels[levelCount++] = copy;
+        }
+        if (lvl) LevelFree(lvl);
+        free(lvl);
+        PackClose(&pr);
+    } else if ((levels = malloc(sizeof(Level *))) && (levels[0] = calloc(1, sizeof(Level)))) {
+        LoadLevel(levels[0], levelMap);
+        levelCount = 1;
+    }
+    int code = 0;
+    uint64_t rng = 12345;
+    EnvBatch eb = {0};
+    uint8_t *actions = NULL;
+    if (!levelCount) {
+        fprintf(stderr, "no levels\n");
+        code = 1;
+    } else if (!EnvCheckAgainstTryMove((const Level *const *)levels, levelCount, levelCount * 4, 2000, &rng)) {
+        printf("batch does not match TryMove\n");
+        code = 2;
+    } else if (!EnvBatchInit(&eb, (const Level *const *)levels, levelCount, count) || !(actions = calloc((size_t)count, 1))) {
+        fprintf(stderr, "out of memory\n");
+        code = 1;
+    } else {
+        printf("%d levels, %d environments; batch matches TryMove and UndoMove\n", levelCount, count);
+        // TryMove on one Level, restarted every 4096 moves so the history stays small
+        Level *lvl = calloc(1, sizeof(Level));
+        long long single = 0;
+        double t0 = NowSeconds(), singleSecs = 0;
+        while (lvl && (singleSecs = NowSeconds() - t0) < seconds) {
+            if (!LevelCopyBoard(lvl, levels[single / 4096 % levelCount])) break;
+            for (int i = 0; i < 4096; i++) {
+                int d = (int)(SplitMix64(&rng) & 3);
+                TryMove(lvl, dirDX[d], dirDY[d]);
+            }
+            single += 4096;
+        }
+        if (lvl) LevelFree(lvl);
+        free(lvl);
+        double singleRate = singleSecs > 0 ? single / singleSecs : 0;
+        printf("TryMove: %.0f steps/sec\n", singleRate);
+
+        printf("threads  steps/sec  speedup  vs_TryMove\n");
+        int maxThreads = DefaultThreadCount();
+        double base = 0;
+        EnvBenchWorker workers[PAR_MAX_THREADS];
+        for (int t = 1; t <= maxThreads; t = (t < maxThreads && t * 2 > maxThreads) ? maxThreads : t * 2) {
+            EnvBatchReset(&eb, 0, count, NULL);
+            int started = 0;
+            for (int i = 0; i < t; i++) {
+                // Split on 64-environment boundaries so workers never share a cache line of flags
+                int per = (count / t + 63) & ~63;
+                workers[i] = (EnvBenchWorker){ &eb, i * per < count ? i * per : count, (i + 1) * per < count ? (i + 1) * per : count, seconds, actions, 0, 0 };
+                if (i == t - 1) workers[i].end = count;
+                if (pthread_create(&workers[i].thread, NULL, EnvBenchMain, &workers[i]) != 0) break;
+                started++;
+            }
+            double start = NowSeconds();
+            long long steps = 0;
+            for (int i = 0; i < started; i++) {
+                pthread_join(workers[i].thread, NULL);
+                steps += workers[i].steps;
+            }
+            double rate = steps / (NowSeconds() - start);
+            if (t == 1) base = rate;
+            printf("%7d  %9.0f  %6.2fx  %9.1fx\n", started, rate, rate / base, singleRate > 0 ? rate / singleRate : 0);
+            if (t == maxThreads) break;
+        }
+    }
+    free(actions);
+    EnvBatchFree(&eb);
+    for (int l = 0; l < levelCount; l++) { LevelFree(levels[l]); free(levels[l]); }
+    free(levels);
+    return code;
+}
+// ========================================================================
+
+// =================== [ Level generator ] ===================
+// New levels built backwards from the goal: boxes start on their targets in a
+// random room and the player pulls them away. A pull is a push played in
+// reverse, so every candidate is solvable by construction. It is still loaded,
+// solved push-optimally and its solution replayed with the game's move rules
+// before it is kept, and that solve scores its difficulty.
+
+#define GEN_MAX_SIDE 64
+#define GEN_MAX_CELLS (GEN_MAX_SIDE * GEN_MAX_SIDE)
+#define GEN_WALL_PERCENT 14     // interior cells turned to wall before trimming to one area
+#define GEN_MAX_MISSES 20000    // candidates in a row without a kept level before giving up
+#define GEN_MAX_EMPTY 200000    // rooms in a row that gave no candidate before giving up
+#define GEN_MIN_FLOOR(boxes) ((boxes) * 3 + 4)  // floor cells a room needs for that many boxes
+
+typedef enum { GEN_KEPT, GEN_NO_ROOM, GEN_GAVE_UP, GEN_FAILED } GenOutcome;
+
+// One worker's scratch: the room being built and the level made from it
+typedef struct {
+    int w, h, cells, boxes;
+    char grid[GEN_MAX_CELLS];           // '#', ' ' or '.'
+    short boxAt[GEN_MAX_CELLS];         // box number + 1, 0 = no box
+    short home[GEN_MAX_CELLS];          // target each box started on
+    short pos[GEN_MAX_CELLS], best[GEN_MAX_CELLS];  // box cells now, and in the position kept
+    short queue[GEN_MAX_CELLS];
+    int label[GEN_MAX_CELLS];           // floor area of a cell, then reach stamps
+    int cand[GEN_MAX_CELLS * 4];        // legal pulls as cell * 4 + d
+    int player, stamp;
+    char text[GEN_MAX_CELLS + GEN_MAX_SIDE];
+    const char *rows[GEN_MAX_SIDE];
+    int rowCount;
+    Level lvl, check;
+    uint64_t rng;
+    int pulls;                          // pulls per candidate, steered toward the band
+} GenWorker;
+
+typedef struct {
+    GenOptions opt;
+    int count;
+    FILE *out;
+    pthread_mutex_t lock;
+    int written, misses, empty;
+    uint64_t *seen;                     // text hashes of written levels (0 = empty slot)
+    size_t seenMask;
+    GenStats stats;
+} GenShared;
+
+static int GenStep(const GenWorker *g, int d) { return dirDY[d] * g->w + dirDX[d]; }
+
+// Flood the floor from c (around boxes when boxesBlock), setting each cell's
+// label; labels only grow, so older ones need no clearing. The cells end up in g->queue
+static int GenFlood(GenWorker *g, int c, int label, bool boxesBlock) {
+    int head = 0, tail = 0;
+    g->label[c] = label;
+    g->queue[tail++] = (short)c;
+    while (head < tail) {
+        int cur = g->queue[head++];
+        for (int d = 0; d < 4; d++) {
+            int n = cur + GenStep(g, d);
+            if (g->grid[n] == '#' || g->label[n] == label) continue;
+            if (boxesBlock && g->boxAt[n]) continue;
+            g->label[n] = label;
+            g->queue[tail++] = (short)n;
+        }
+    }
+    return tail;
+}
+
+// Random walls inside a border, trimmed to the largest floor area, with boxes
+// on random targets and the player on another floor cell
+static bool GenRoom(GenWorker *g) {
+    for (int c = 0; c < g->cells; c++) {
+        int x = c % g->w, y = c / g->w;
+        bool border = x == 0 || y == 0 || x == g->w - 1 || y == g->h - 1;
+        g->grid[c] = border || SplitMix64(&g->rng) % 100 < GEN_WALL_PERCENT ? '#' : ' ';
+        g->boxAt[c] = 0;
+        g->label[c] = 0;
+    }
+    int areas = 0, best = 0, bestSize = 0;
+    for (int c = 0; c < g->cells; c++) {
+        if (g->grid[c] == '#' || g->label[c]) continue;
+        int size = GenFlood(g, c, ++areas, false);
+        if (size > bestSize) { best = areas; bestSize = size; }
+    }
+    g->stamp = areas;
+    if (bestSize < GEN_MIN_FLOOR(g->boxes)) return false;
+
+    int floor = 0;
+    for (int c = 0; c < g->cells; c++) {
+        if (g->grid[c] == '#') continue;
+        if (g->label[c] != best) g->grid[c] = '#';
+        else g->queue[floor++] = (short)c;
+    }
+    // Partial shuffle: the first boxes cells become targets, the next the player
+    for (int i = 0; i <= g->boxes; i++) {
+        int j = i + (int)(SplitMix64(&g->rng) % (uint64_t)(floor - i));
+        short t = g->queue[i]; g->queue[i] = g->queue[j]; g->queue[j] = t;
+    }
+    for (int i = 0; i < g->boxes; i++) {
+        g->grid[g->queue[i]] = '.';
+        g->boxAt[g->queue[i]] = (short)(i + 1);
+        g->home[i] = g->queue[i];
+    }
+    g->player = g->queue[g->boxes];
+    return true;
+}
+
+// Grid distance between two cells
+static int GenDistance(const GenWorker *g, int a, int b) {
+    return abs(a % g->w - b % g->w) + abs(a / g->w - b / g->w);
+}
+
+// Pull random boxes from wherever the player can walk; half the time the last
+// pull is repeated when it still can be, so boxes travel in lines. The walk
+// drifts back and forth, so it ends on the position it passed through with
+// the boxes furthest from their targets.
+static void GenPullBoxes(GenWorker *g, int pulls) {
+    int last = -1, spread = 0, bestSpread = 0, bestPlayer = g->player;
+    for (int i = 0; i < g->boxes; i++) g->pos[i] = g->best[i] = g->home[i];
+    for (int k = 0; k < pulls; k++) {
+        int reach = GenFlood(g, g->player, ++g->stamp, true), count = 0;
+        for (int i = 0; i < reach; i++) {
+            int p = g->queue[i];
+            for (int d = 0; d < 4; d++) {
+                // Box ahead of p, free floor behind: the player steps back and drags it
+                int box = p + GenStep(g, d), back = p - GenStep(g, d);
+                if (g->boxAt[box] && g->grid[back] != '#' && !g->boxAt[back]) g->cand[count++] = p * 4 + d;
+            }
+        }
+        if (count == 0) break;
+        int pick = g->cand[SplitMix64(&g->rng) % (uint64_t)count];
+        if (last >= 0 && (SplitMix64(&g->rng) & 1))
+            for (int i = 0; i < count; i++) if (g->cand[i] == last) pick = last;
+        int p = pick / 4, d = pick % 4;
+        int box = p + GenStep(g, d), back = p - GenStep(g, d);
+        int id = g->boxAt[box] - 1;
+        spread += GenDistance(g, p, g->home[id]) - GenDistance(g, box, g->home[id]);
+        g->boxAt[p] = (short)(id + 1);
+        g->boxAt[box] = 0;
+        g->pos[id] = (short)p;
+        g->player = back;
+        last = back * 4 + d;
+        if (spread > bestSpread) {
+            bestSpread = spread;
+            bestPlayer = back;
+            memcpy(g->best, g->pos, (size_t)g->boxes * sizeof(short));
+        }
+    }
+    for (int i = 0; i < g->boxes; i++) g->boxAt[g->pos[i]] = 0;
+    for (int i = 0; i < g->boxes; i++) g->boxAt[g->best[i]] = (short)(i + 1);
+    g->player = bestPlayer;
+}
+
+// Rows of the room in XSB: walls with no floor around them become blanks,
+// all-blank rows and columns go, and rows lose trailing blanks
+static void GenRender(GenWorker *g) {
+    static const char *glyphs[2][2] = { { " .", "$*" }, { "@+", "@+" } };
+    int x0 = g->w, x1 = -1, y0 = g->h, y1 = -1;
+    for (int c = 0; c < g->cells; c++) {
+        if (g->grid[c] == '#') continue;
+        int x = c % g->w, y = c / g->w;
+        if (x - 1 < x0) x0 = x - 1;
+        if (x + 1 > x1) x1 = x + 1;
+        if (y - 1 < y0) y0 = y - 1;
+        if (y + 1 > y1) y1 = y + 1;
+    }
+    char *out = g->text;
+    g->rowCount = 0;
+    for (int y = y0; y <= y1; y++) {
+        g->rows[g->rowCount++] = out;
+        char *end = out;
+        for (int x = x0; x <= x1; x++) {
+            int c = y * g->w + x;
+            char ch;
+            if (g->grid[c] == '#') {
+                bool inner = false;
+                for (int dy = -1; dy <= 1; dy++)
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int nx = x + dx, ny = y + dy;
+                        if (nx >= 0 && ny >= 0 && nx < g->w && ny < g->h && g->grid[ny * g->w + nx] != '#') inner = true;
+                    }
+                ch = inner ? '#' : ' ';
+            } else {
+                ch = glyphs[c == g->player][g->boxAt[c] != 0][g->grid[c] == '.'];
+            }
+            *out++ = ch;
+            if (ch != ' ') end = out;
+        }
+        out = end;
+        *out++ = 0;
+    }
+}
+
+// Build, verify and score one candidate with g->pulls pulls
+static GenOutcome GenCandidate(GenWorker *g, long long maxNodes, GenScore *score) {
+    if (!GenRoom(g)) return GEN_NO_ROOM;
+    GenPullBoxes(g, g->pulls);
+    // A box still on the target it started on took no part in the puzzle
+    for (int i = 0; i < g->boxes; i++)
+        if (g->boxAt[g->home[i]] == i + 1) return GEN_NO_ROOM;
+    GenRender(g);
+
+    if (LoadLevelRows(&g->lvl, g->rows, g->rowCount) != LEVEL_OK || LevelSolved(&g->lvl)) return GEN_FAILED;
+    SolveResult res = {0};
+    SolveLevelWith(&g->lvl, HEURISTIC_MATCHING, maxNodes, &res);
+    if (res.solved != 1) { free(res.steps); return res.solved < 0 ? GEN_GAVE_UP : GEN_FAILED; }
+
+    // Replay the solution on a fresh copy, letter by letter as a player would
+    char *lurd = malloc((size_t)res.moves + 1);
+    ReplayResult rr;
+    bool ok = lurd && LurdEncode(res.steps, res.moves, lurd, (size_t)res.moves + 1) == res.moves &&
+              LevelCopyBoard(&g->check, &g->lvl) && ReplayLurd(&g->check, lurd, (size_t)res.moves, &rr) == REPLAY_SOLVED;
+    free(lurd);
+    free(res.steps);
+    if (!ok) return GEN_FAILED;
+
+    score->pushes = res.pushes;
+    score->moves = res.moves;
+    score->nodes = res.expanded;
+    score->difficulty = res.pushes + res.moves / 8 + 4 * BitHighest((uint64_t)res.expanded + 1);
+    return GEN_KEPT;
+}
+
+// Record the level's text hash; false when it was there already
+static bool GenFirstSeen(GenShared *sh, const GenWorker *g) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int r = 0; r < g->rowCount; r++)
+        for (const char *s = g->rows[r]; ; s++) {
+            h = (h ^ (unsigned char)*s) * 0x100000001B3ULL;     // row NULs separate rows
+            if (!*s) break;
+        }
+    if (h == 0) h = 1;
+    size_t i = (size_t)h & sh->seenMask;
+    while (sh->seen[i]) {
+        if (sh->seen[i] == h) return false;
+        i = (i + 1) & sh->seenMask;
+    }
+    sh->seen[i] = h;
+    return true;
+}
+
+static void *GenWorkerMain(void *arg) {
+    GenShared *sh = ((void **)arg)[0];
+    GenWorker *g = ((void **)arg)[1];
+    const GenOptions *opt = &sh->opt;
+    for (;;) {
+        GenScore score = {0};
+        GenOutcome outcome = GenCandidate(g, opt->maxNodes, &score);
+        bool easy = outcome == GEN_KEPT && score.difficulty < opt->minDifficulty;
+        bool hard = outcome == GEN_GAVE_UP || (outcome == GEN_KEPT && opt->maxDifficulty && score.difficulty > opt->maxDifficulty);
+        // Steer toward the band: more pulls scatter the boxes further
+        if (easy && g->pulls < g->boxes * 64) g->pulls += g->boxes;
+        if (hard && g->pulls > g->boxes) g->pulls -= g->boxes;
+
+        pthread_mutex_lock(&sh->lock);
+        bool stop = sh->written >= sh->count || sh->misses >= GEN_MAX_MISSES || sh->empty >= GEN_MAX_EMPTY;
+        // Rooms too cramped to build or pull in are cheap, so they get their own limit
+        if (!stop && outcome == GEN_NO_ROOM) sh->empty++;
+        if (!stop && outcome != GEN_NO_ROOM) {
+            sh->empty = 0;
+            GenStats *st = &sh->stats;
+            st->candidates++;
+            sh->misses++;
+            if (outcome == GEN_GAVE_UP) st->gaveUp++;
+            else if (outcome == GEN_FAILED) st->failed++;
+            else if (easy || hard) st->outOfBand++;
+            else if (!GenFirstSeen(sh, g)) st->duplicates++;
+            else {
+                sh->misses = 0;
+                st->levels = ++sh->written;
+                fprintf(sh->out, "; %d pushes, %d moves, %lld nodes, difficulty %d\n",
+                        score.pushes, score.moves, score.nodes, score.difficulty);
+                for (int r = 0; r < g->rowCount; r++) fprintf(sh->out, "%s\n", g->rows[r]);
+                fprintf(sh->out, "Title: Generated %d\n\n", sh->written);
+            }
+        }
+        pthread_mutex_unlock(&sh->lock);
+        if (stop) break;
+    }
+    return NULL;
+}
+
+// Write count new levels to out as an XSB pack, generated on opt->threads
+// threads. Levels are verified solvable, have no duplicates and score within
+// [minDifficulty, maxDifficulty]. Returns how many were written: fewer than
+// count when GEN_MAX_MISSES candidates in a row missed the band or
+// GEN_MAX_EMPTY rooms in a row gave no candidate; -1 when the room can never
+// hold that many boxes.
+int GenerateLevels(const GenOptions *opt, int count, FILE *out, GenStats *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    GenShared *sh = calloc(1, sizeof(GenShared));
+    if (!sh) return 0;
+    sh->opt = *opt;
+    GenOptions *o = &sh->opt;
+    if (o->width <= 0) o->width = 9;
+    if (o->height <= 0) o->height = 9;
+    if (o->width < 5) o->width = 5;
+    if (o->height < 5) o->height = 5;
+    if (o->width > GEN_MAX_SIDE) o->width = GEN_MAX_SIDE;
+    if (o->height > GEN_MAX_SIDE) o->height = GEN_MAX_SIDE;
+    if (o->boxes <= 0) o->boxes = 3;
+    if (o->maxNodes <= 0) o->maxNodes = 100000;
+    if (o->threads <= 0) o->threads = DefaultThreadCount();
+    if (o->threads > PAR_MAX_THREADS) o->threads = PAR_MAX_THREADS;
+    if ((o->width - 2) * (o->height - 2) < GEN_MIN_FLOOR(o->boxes) || o->boxes > SOLVER_MAX_BOXES) {
+        free(sh);
+        return -1;
+    }
+    sh->count = count;
+    sh->out = out;
+    size_t slots = 64;
+    while (slots < (size_t)count * 2) slots *= 2;
+    sh->seen = calloc(slots, sizeof(uint64_t));
+    sh->seenMask = slots - 1;
+    pthread_mutex_init(&sh->lock, NULL);
+
+    double t0 = NowSeconds();
+    GenWorker *workers[PAR_MAX_THREADS] = {0};
+    void *args[PAR_MAX_THREADS][2];
+    pthread_t tids[PAR_MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < o->threads && sh->seen; i++) {
+        GenWorker *g = workers[i] = calloc(1, sizeof(GenWorker));
+        if (!g) break;
+        g->w = o->width;
+        g->h = o->height;
+        g->cells = g->w * g->h;
+        g->boxes = o->boxes;
+        g->pulls = g->boxes * 4;
+        g->rng = o->seed + (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+        args[i][0] = sh;
+        args[i][1] = g;
+        if (pthread_create(&tids[i], NULL, GenWorkerMain, args[i]) != 0) break;
+        started++;
+    }
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+    for (int i = 0; i < o->threads; i++) {
+        if (!workers[i]) continue;
+        LevelFree(&workers[i]->lvl);
+        LevelFree(&workers[i]->check);
+        free(workers[i]);
+    }
+    fflush(out);
+    sh->stats.seconds = NowSeconds() - t0;
+    if (stats) *stats = sh->stats;
+    int written = sh->written;
+    pthread_mutex_destroy(&sh->lock);
+    free(sh->seen);
+    free(sh);
+    return written;
+}
+
+// `my_game --generate count [min-max] [WxH] [boxes] [threads] [seed]`: write
+// count verified levels with a difficulty in min..max to stdout as an XSB pack;
+// a summary goes to stderr. Exit code 0 when all count were written.
+static int RunGenerateCli(int argc, char **argv) {
+    GenOptions opt = {0};
+    int count = argc > 2 ? atoi(argv[2]) : 100;
+    if (argc > 3 && sscanf(argv[3], "%d-%d", &opt.minDifficulty, &opt.maxDifficulty) < 1) {
+        fprintf(stderr, "difficulty band must look like 20-60\n");
+        return 1;
+    }
+    if (argc > 4 && sscanf(argv[4], "%dx%d", &opt.width, &opt.height) != 2) {
+        fprintf(stderr, "room size must look like 9x9\n");
+        return 1;
+    }
+    opt.boxes = argc > 5 ? atoi(argv[5]) : 0;
+    opt.threads = argc > 6 ? atoi(argv[6]) : 0;
+    opt.seed = argc > 7 ? strtoull(argv[7], NULL, 10) : (uint64_t)time(NULL);
+    if (count < 1) count = 1;
+
+    GenStats st;
+    int written = GenerateLevels(&opt, count, stdout, &st);
+    if (written < 0) {
+        fprintf(stderr, "a room of that size cannot hold that many boxes (at most %d, and 3 floor cells each)\n", SOLVER_MAX_BOXES);
+        return 1;
+    }
+    fprintf(stderr, "%d levels from %lld candidates in %.2f s (%.0f levels/min); "
+            "%lld out of band, %lld duplicates, %lld over the node budget, %lld failed\n",
+            written, st.candidates, st.seconds, st.seconds > 0 ? written * 60 / st.seconds : 0,
+            st.outOfBand, st.duplicates, st.gaveUp, st.failed);
+    return written == count && st.failed == 0 ? 0 : 2;
+}
+// ========================================================================
+
+// =================== [ Save snapshots ] ===================
+// The game's progress as a small file: the level number, a hash of its board
+// and the move history packed four moves to a byte. Resuming loads the level,
+// replays the history with the normal move rules (rebuilding the undo log and
+// its checkpoints) and checks the result against the saved state hash, so a
+// snapshot of another board or a damaged file is refused rather than shown.
+// SnapshotWriter saves from a background thread: posting copies the history,
+// and the file is written to a temporary name, flushed to disk and renamed
+// over the old one, so a crash leaves either the old snapshot or the new one.
+
+// CRC-32 (IEEE, reflected); tiny inputs, so bit at a time is fast enough
+static uint32_t Crc32(const unsigned char *p, size_t n) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+// Identity of a board: size, walls and targets (not the boxes, which move)
+uint64_t SnapshotBoardHash(const Level *lvl) {
+    uint64_t h = 0xCBF29CE484222325ULL ^ ((uint64_t)lvl->w << 32 | (uint32_t)lvl->h);
+    for (int i = 0; i < lvl->words; i++) {
+        h = (h ^ lvl->walls[i]) * 0x100000001B3ULL;
+        h = (h ^ lvl->targets[i]) * 0x100000001B3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+#define SNAPSHOT_HEADER_BYTES 40     // SnapshotHeader's fields back to back
+
+static void PutLE(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint64_t GetLE(const unsigned char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static size_t SnapshotSize(int count) {
+    return SNAPSHOT_HEADER_BYTES + ((size_t)count + 3) / 4 + sizeof(uint32_t);
+}
+
+// Write lvl's snapshot to out; returns its size, and writes nothing when that
+// is more than cap (so a first call with cap 0 sizes the buffer)
+size_t SnapshotEncode(const Level *lvl, uint32_t level, unsigned char *out, size_t cap) {
+    const MoveLog *log = &lvl->log;
+    size_t size = SnapshotSize(log->count);
+    if (size > cap) return size;
+    PutLE(out, SNAPSHOT_MAGIC, 4);
+    PutLE(out + 4, SNAPSHOT_VERSION, 2);
+    PutLE(out + 6, SNAPSHOT_HEADER_BYTES, 2);
+    PutLE(out + 8, level, 4);
+    PutLE(out + 12, (uint32_t)log->count, 4);
+    PutLE(out + 16, (uint32_t)log->pos, 4);
+    PutLE(out + 20, 0, 4);
+    PutLE(out + 24, SnapshotBoardHash(lvl), 8);
+    PutLE(out + 32, lvl->hash, 8);
+    unsigned char *moves = out + SNAPSHOT_HEADER_BYTES;
+    memset(moves, 0, ((size_t)log->count + 3) / 4);
+    for (int i = 0; i < log->count; i++) moves[i >> 2] |= (unsigned char)((log->moves[i] & MOVE_DIR_MASK) << ((i & 3) * 2));
+    PutLE(out + size - 4, Crc32(out, size - 4), 4);
+    return size;
+}
+
+// Check a snapshot's framing and checksum and return its header
+SnapshotStatus SnapshotRead(const unsigned char *data, size_t size, SnapshotHeader *hdr) {
+    if (size < SNAPSHOT_HEADER_BYTES + sizeof(uint32_t)) return SNAPSHOT_TRUNCATED;
+    hdr->magic = (uint32_t)GetLE(data, 4);
+    hdr->version = (uint16_t)GetLE(data + 4, 2);
+    hdr->headerSize = (uint16_t)GetLE(data + 6, 2);
+    hdr->level = (uint32_t)GetLE(data + 8, 4);
+    hdr->count = (uint32_t)GetLE(data + 12, 4);
+    hdr->pos = (uint32_t)GetLE(data + 16, 4);
+    hdr->reserved = (uint32_t)GetLE(data + 20, 4);
+    hdr->board = GetLE(data + 24, 8);
+    hdr->hash = GetLE(data + 32, 8);
+    if (hdr->magic != SNAPSHOT_MAGIC) return SNAPSHOT_BAD_MAGIC;
+    if (hdr->version > SNAPSHOT_VERSION) return SNAPSHOT_NEWER_VERSION;
+    if (hdr->headerSize != SNAPSHOT_HEADER_BYTES || hdr->pos > hdr->count || hdr->count > INT_MAX / 2 ||
+        size != SnapshotSize((int)hdr->count)) return SNAPSHOT_TRUNCATED;
+    return GetLE(data + size - 4, 4) == Crc32(data, size - 4) ? SNAPSHOT_OK : SNAPSHOT_BAD_CHECKSUM;
+}
+
+// Resume a snapshot on lvl, which must hold its level as loaded (no moves).
+// On failure lvl is left somewhere along the history: reload it.
+SnapshotStatus SnapshotApply(Level *lvl, const unsigned char *data, size_t size) {
+    SnapshotHeader hdr;
+    SnapshotStatus st = SnapshotRead(data, size, &hdr);
+    if (st != SNAPSHOT_OK) return st;
+    if (hdr.board != SnapshotBoardHash(lvl)) return SNAPSHOT_OTHER_BOARD;
+
+    MoveLog *log = &lvl->log;
+    int count = (int)hdr.count;
+    if (log->cap < count) {
+        unsigned char *moves = realloc(log->moves, (size_t)count);
+        if (!moves) return SNAPSHOT_NO_MEMORY;
+        log->moves = moves;
+        log->cap = count;
+    }
+    // The whole history, redo tail included, as TryMove would have recorded it
+    const unsigned char *packed = data + SNAPSHOT_HEADER_BYTES;
+    log->pos = log->count = log->snapCount = 0;
+    for (int i = 0; i < count; i++) {
+        int m = LevelStepLayers(lvl, (packed[i >> 2] >> ((i & 3) * 2)) & 3);
+        if (m < 0) return SNAPSHOT_BAD_MOVES;
+        log->moves[log->pos++] = (unsigned char)m;
+        if (log->pos % MOVELOG_CHECKPOINT == 0 && log->snapCount == log->pos / MOVELOG_CHECKPOINT) MoveLogSnapshot(lvl);
+    }
+    log->count = count;
+    JumpToMove(lvl, (int)hdr.pos);
+    lvl->deadlock = LevelDeadlock(lvl);
+    return lvl->hash == hdr.hash ? SNAPSHOT_OK : SNAPSHOT_BAD_MOVES;
+}
+
+const char *SnapshotStatusText(SnapshotStatus st) {
+    switch (st) {
+        case SNAPSHOT_OK: return "ok";
+        case SNAPSHOT_TRUNCATED: return "truncated";
+        case SNAPSHOT_BAD_MAGIC: return "not a snapshot";
+        case SNAPSHOT_NEWER_VERSION: return "newer version";
+        case SNAPSHOT_BAD_CHECKSUM: return "checksum mismatch";
+        case SNAPSHOT_OTHER_BOARD: return "different board";
+        case SNAPSHOT_BAD_MOVES: return "history does not replay";
+        case SNAPSHOT_NO_MEMORY: return "out of memory";
+    }
+    return "unknown";
+}
+
+// Replace path with data atomically: write a temporary file next to it, flush
+// it to disk, then rename it over path
+bool SnapshotSaveFile(const char *path, const void *data, size_t size) {
+    char tmp[1024];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return false;
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size && fflush(f) == 0;
+#if defined(_WIN32)
+    ok = ok && FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(f)));
+    ok = fclose(f) == 0 && ok;
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (ok) {
+        // Make the rename itself durable
+        char dir[1024];
+        snprintf(dir, sizeof(dir), "%s", path);
+        char *slash = strrchr(dir, '/');
+        if (slash) *(slash == dir ? slash + 1 : slash) = 0;
+        int fd = open(slash ? dir : ".", O_RDONLY);
+        if (fd >= 0) { fsync(fd); close(fd); }
+    }
+#endif
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+// Whole file, malloc'd; NULL when it cannot be read
+unsigned char *SnapshotLoadFile(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    unsigned char *data = NULL;
+    long len = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    if (len >= 0 && fseek(f, 0, SEEK_SET) == 0 && (data = malloc(len ? (size_t)len : 1))) {
+        if (fread(data, 1, (size_t)len, f) != (size_t)len) { free(data); data = NULL; }
+        else *size = (size_t)len;
+    }
+    fclose(f);
+    return data;
+}
+
+struct SnapshotWriter {
+    pthread_t thread;
+    pthread_mutex_t lock;           // guards everything below but the path
+    pthread_cond_t wake;
+    unsigned char *pending;         // latest posted snapshot, written next
+    size_t pendingSize, pendingCap;
+    bool quit;
+    int saved, failed;
+    double minInterval;
+    char path[1024];
+};
+
+// Write whatever was posted last, then rest minInterval so a burst of moves
+// costs one write; quitting cuts the rest short and writes what is left
+static void *SnapshotWriterMain(void *arg) {
+    SnapshotWriter *sw = arg;
+    unsigned char *buf = NULL;
+    size_t cap = 0;
+    pthread_mutex_lock(&sw->lock);
+    for (;;) {
+        while (!sw->pendingSize && !sw->quit) pthread_cond_wait(&sw->wake, &sw->lock);
+        if (!sw->pendingSize) break;
+        // Swap buffers, each with its own capacity, so posting can go on
+        // while this one is written
+        unsigned char *data = sw->pending;
+        size_t size = sw->pendingSize, dataCap = sw->pendingCap;
+        sw->pending = buf;
+        sw->pendingCap = cap;
+        sw->pendingSize = 0;
+        buf = data;
+        cap = dataCap;
+        pthread_mutex_unlock(&sw->lock);
+        bool ok = SnapshotSaveFile(sw->path, data, size);
+        pthread_mutex_lock(&sw->lock);
+        if (ok) sw->saved++;
+        else sw->failed++;
+
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        double t = until.tv_nsec / 1e9 + sw->minInterval;
+        until.tv_sec += (time_t)t;
+        until.tv_nsec = (long)((t - (double)(time_t)t) * 1e9);
+        while (!sw->quit && pthread_cond_timedwait(&sw->wake, &sw->lock, &until) == 0) {}
+    }
+    pthread_mutex_unlock(&sw->lock);
+    free(buf);
+    return NULL;
+}
+
+// Background saver to path, at most one write per minInterval seconds
+SnapshotWriter *SnapshotWriterStart(const char *path, double minInterval) {
+    SnapshotWriter *sw = calloc(1, sizeof(SnapshotWriter));
+    if (!sw) return NULL;
+    snprintf(sw->path, sizeof(sw->path), "%s", path);
+    sw->minInterval = minInterval > 0 ? minInterval : 0;
+    pthread_mutex_init(&sw->lock, NULL);
+    pthread_cond_init(&sw->wake, NULL);
+    if (pthread_create(&sw->thread, NULL, SnapshotWriterMain, sw) != 0) {
+        pthread_mutex_destroy(&sw->lock);
+        pthread_cond_destroy(&sw->wake);
+        free(sw);
+        return NULL;
+    }
+    return sw;
+}
+
+// Queue lvl's snapshot, replacing one not yet written. Costs an encode of the
+// history (a quarter byte per move); the disk is only touched by the writer.
+bool SnapshotWriterPost(SnapshotWriter *sw, const Level *lvl, uint32_t level) {
+    if (!sw) return false;
+    pthread_mutex_lock(&sw->lock);
+    size_t size = SnapshotEncode(lvl, level, sw->pending, sw->pendingCap);
+    if (size > sw->pendingCap) {
+        unsigned char *grown = realloc(sw->pending, size * 2);
+        if (grown) {
+            sw->pending = grown;
+            sw->pendingCap = size * 2;
+            SnapshotEncode(lvl, level, sw->pending, sw->pendingCap);
+        }
+    }
+    bool ok = size <= sw->pendingCap;
+    if (ok) {
+        sw->pendingSize = size;
+        pthread_cond_signal(&sw->wake);
+    }
+    pthread_mutex_unlock(&sw->lock);
+    return ok;
+}
+
+// Snapshots written so far; *failed (may be NULL) gets the writes that failed
+int SnapshotWriterSaved(SnapshotWriter *sw, int *failed) {
+    if (!sw) return 0;
+    pthread_mutex_lock(&sw->lock);
+    int saved = sw->saved;
+    if (failed) *failed = sw->failed;
+    pthread_mutex_unlock(&sw->lock);
+    return saved;
+}
+
+// Write any pending snapshot and stop the thread
+void SnapshotWriterStop(SnapshotWriter *sw) {
+    if (!sw) return;
+    pthread_mutex_lock(&sw->lock);
+    sw->quit = true;
+    pthread_cond_signal(&sw->wake);
+    pthread_mutex_unlock(&sw->lock);
+    pthread_join(sw->thread, NULL);
+    pthread_mutex_destroy(&sw->lock);
+    pthread_cond_destroy(&sw->wake);
+    free(sw->pending);
+    free(sw);
+}
+
+// Restart lvl on the bundled level and play random moves and undos until
+// the history holds moves of them
+static void SnapshotBenchPlay(Level *lvl, int moves, uint64_t seed) {
+    LoadLevel(lvl, levelMap);
+    while (lvl->log.count < moves) {
+        uint64_t r = SplitMix64(&seed);
+        if (r % 8 == 0) UndoMove(lvl);
+        else { int d = (int)(r >> 8) & 3; TryMove(lvl, dirDX[d], dirDY[d]); }
+    }
+}
+
+// Post histories that shrink and grow again through a SnapshotWriter, as
+// restarts during play do, and check each written file against its post
+static bool SnapshotBenchWriter(int moves, const char *path) {
+    SnapshotWriter *sw = SnapshotWriterStart(path, 0);
+    Level *lvl = calloc(1, sizeof(Level));
+    const int lengths[] = { moves, 0, 500, moves, 0, 500, moves };
+    bool ok = sw && lvl;
+    for (int i = 0; ok && i < (int)(sizeof(lengths) / sizeof(lengths[0])); i++) {
+        SnapshotBenchPlay(lvl, lengths[i], 11 + (uint64_t)i);
+        int saved = SnapshotWriterSaved(sw, NULL);
+        ok = SnapshotWriterPost(sw, lvl, 0);
+        while (ok && SnapshotWriterSaved(sw, NULL) == saved) sched_yield();
+        size_t size = SnapshotEncode(lvl, 0, NULL, 0), len = 0;
+        unsigned char *want = malloc(size), *file = SnapshotLoadFile(path, &len);
+        ok = ok && want && file && SnapshotEncode(lvl, 0, want, size) == size && len == size && !memcmp(file, want, size);
+        free(want);
+        free(file);
+    }
+    SnapshotWriterStop(sw);
+    if (lvl) LevelFree(lvl);
+    free(lvl);
+    return ok;
+}
+
+// `my_game --bench-snapshot [moves] [path]`: play random moves and undos on
+// the bundled level, then time encoding, the atomic save, loading and
+// resuming, and check the resumed level against the original. Also posts a
+// shrinking then growing history through a SnapshotWriter. Exit code 0 when
+// everything matches and the median resume takes under a millisecond.
+static int RunSnapshotBenchCli(int moves, const char *path) {
+    if (moves < 1) moves = 10000;
+    if (!path) path = "sokoban-bench.save";
+    Level *lvl = calloc(1, sizeof(Level)), *back = calloc(1, sizeof(Level));
+    if (!lvl || !back) { free(lvl); free(back); return 1; }
+    SnapshotBenchPlay(lvl, moves, 7);
+    JumpToMove(lvl, lvl->log.count - lvl->log.count / 10);    // leave a redo tail
+
+    size_t size = SnapshotEncode(lvl, 0, NULL, 0);
+    unsigned char *data = malloc(size);
+    int code = 0;
+    enum { REPEAT = 50 };
+    double encodeMs = 0, saveMs = 0, resumeMs[REPEAT];
+    for (int i = 0; i < REPEAT && data && !code; i++) {
+        double t0 = NowSeconds();
+        SnapshotEncode(lvl, 0, data, size);
+        double t1 = NowSeconds();
+        if (!SnapshotSaveFile(path, data, size)) { fprintf(stderr, "cannot write %s\n", path); code = 1; break; }
+        double t2 = NowSeconds();
+        // Resume as the game does: read the file, load the level, replay
+        size_t len = 0;
+        unsigned char *file = SnapshotLoadFile(path, &len);
+        SnapshotStatus st = SNAPSHOT_TRUNCATED;
+        if (file && LoadLevel(back, levelMap) == LEVEL_OK) st = SnapshotApply(back, file, len);
+        double t3 = NowSeconds();
+        free(file);
+        bool same = st == SNAPSHOT_OK && back->px == lvl->px && back->py == lvl->py && back->hash == lvl->hash &&
+                    back->deadlock == lvl->deadlock && back->log.pos == lvl->log.pos && back->log.count == lvl->log.count &&
+                    memcmp(back->log.moves, lvl->log.moves, (size_t)lvl->log.count) == 0;
+        if (!same) { printf("resumed level differs: %s\n", SnapshotStatusText(st)); code = 2; }
+        encodeMs += (t1 - t0) * 1e3;
+        saveMs += (t2 - t1) * 1e3;
+        resumeMs[i] = (t3 - t2) * 1e3;
+    }
+    // A damaged byte anywhere must be caught by the checksum
+    if (data && !code) {
+        data[size / 2] ^= 0x10;
+        SnapshotHeader hdr;
+        if (SnapshotRead(data, size, &hdr) != SNAPSHOT_BAD_CHECKSUM) { printf("corruption not detected\n"); code = 2; }
+    }
+    if (!code && !SnapshotBenchWriter(moves, path)) { printf("background writer saved a different snapshot\n"); code = 2; }
+    if (!code) {
+        printf("%d moves (%d applied): %zu bytes\n", lvl->log.count, lvl->log.pos, size);
+        qsort(resumeMs, REPEAT, sizeof(double), CompareDoubles);
+        printf("encode %.3f ms  atomic save %.3f ms  resume p50 %.3f ms, max %.3f ms\n",
+               encodeMs / REPEAT, saveMs / REPEAT, resumeMs[REPEAT / 2], resumeMs[REPEAT - 1]);
+        if (resumeMs[REPEAT / 2] >= 1) code = 3;
+    }
+    remove(path);
+    free(data);
+    LevelFree(lvl);
+    LevelFree(back);
+    free(lvl);
+    free(back);
+    return code;
+}
+// ========================================================================
+
+// =================== [ Asset bundle ] ===================
+// The game maps the bundle and reads it in place; the only work at open time
+// is checking that the section table stays inside the file. Levels are
+// checked when they are loaded, so opening a pack of any size costs the same.
+
+static void BundleUnmap(const void *data, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+// Map path read-only; NULL when it is missing, empty or cannot be mapped
+static const unsigned char *BundleMap(const char *path, size_t *size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER len;
+    HANDLE map = NULL;
+    if (GetFileSizeEx(file, &len) && len.QuadPart > 0) map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!map) return NULL;
+    const unsigned char *data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(map);       // the view keeps the mapping alive
+    *size = (size_t)len.QuadPart;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+bool BundleOpen(Bundle *b, const char *path) {
+    memset(b, 0, sizeof(*b));
+    size_t size = 0;
+    const unsigned char *data = BundleMap(path, &size);
+    if (!data) return false;
+    const BundleHeader *hdr = (const BundleHeader *)data;
+    bool ok = size >= sizeof(BundleHeader) && hdr->magic == BUNDLE_MAGIC && hdr->version == BUNDLE_VERSION
+           && hdr->sectionCount <= BUNDLE_MAX_SECTIONS
+           && size - sizeof(BundleHeader) >= hdr->sectionCount * sizeof(BundleSection);
+    const BundleSection *sec = (const BundleSection *)(data + sizeof(BundleHeader));
+    for (uint32_t i = 0; ok && i < hdr->sectionCount; i++)
+        ok = sec[i].offset % 8 == 0 && sec[i].offset <= size && sec[i].size <= size - sec[i].offset;
+    if (!ok) {
+        BundleUnmap(data, size);
+        return false;
+    }
+    b->data = data;
+    b->size = size;
+    b->sections = sec;
+    b->sectionCount = (int)hdr->sectionCount;
+
+    size_t bytes;
+    const unsigned char *lv = BundleFind(b, BUNDLE_LEVELS, &bytes);
+    if (lv && bytes >= 8) {
+        uint32_t count;
+        memcpy(&count, lv, sizeof(count));
+        if ((bytes - 8) / sizeof(BundleLevel) >= count) {
+            b->levelData = lv;
+            b->levelBytes = bytes;
+            b->levels = (const BundleLevel *)(lv + 8);
+            b->levelCount = (int)count;
+        }
+    }
+    return true;
+}
+
+void BundleClose(Bundle *b) {
+    if (b->data) BundleUnmap(b->data, b->size);
+    memset(b, 0, sizeof(*b));
+}
+
+// Start and size of the first section tagged tag, or NULL
+const void *BundleFind(const Bundle *b, uint32_t tag, size_t *size) {
+    for (int i = 0; i < b->sectionCount; i++) {
+        if (b->sections[i].tag != tag) continue;
+        *size = (size_t)b->sections[i].size;
+        return b->data + b->sections[i].offset;
+    }
+    return NULL;
+}
+
+// RGBA8 pixels of an image section (header copied to info), or NULL
+const void *BundleImagePixels(const Bundle *b, uint32_t tag, BundleImage *info) {
+    size_t size;
+    const unsigned char *p = BundleFind(b, tag, &size);
+    if (!p || size < sizeof(BundleImage)) return NULL;
+    memcpy(info, p, sizeof(BundleImage));
+    if (info->width == 0 || info->height == 0 || info->width > 16384 || info->height > 16384) return NULL;
+    if ((size - sizeof(BundleImage)) / 4 / info->width < info->height) return NULL;
+    return p + sizeof(BundleImage);
+}
+
+const char *BundleLevelTitle(const Bundle *b, int index) {
+    if (index < 0 || index >= b->levelCount) return "";
+    uint32_t at = b->levels[index].title;
+    if (at >= b->levelBytes || !memchr(b->levelData + at, 0, b->levelBytes - at)) return "";
+    return (const char *)b->levelData + at;
+}
+
+// Load level index of the bundle. Dead squares and the start deadlock come
+// baked, so this is a copy plus O(boxes) counting. The record is checked
+// against the rules LoadLevelRows enforces, so a damaged file cannot produce
+// an impossible board.
+LevelStatus LoadBundleLevel(Level *lvl, const Bundle *b, int index) {
+    LevelReset(lvl);
+    if (index < 0 || index >= b->levelCount) return LEVEL_EMPTY;
+    BundleLevel e = b->levels[index];
+    if (e.w == 0 || e.h == 0) return LEVEL_CORRUPT;
+    if (e.w > MAX_W || e.h > MAX_H) return LEVEL_TOO_BIG;
+    int words = (e.w * e.h + 63) / 64;
+    size_t layer = (size_t)words * sizeof(uint64_t);
+    if (e.px >= e.w || e.py >= e.h || e.deadlock > DEADLOCK_CORRAL
+        || e.record > b->levelBytes || 4 * layer > b->levelBytes - e.record) return LEVEL_CORRUPT;
+    if (!LevelArena(lvl, e.w, e.h)) return LEVEL_NO_MEMORY;
+
+    memcpy(lvl->walls, b->levelData + e.record, 4 * layer);
+    memset(lvl->scratch, 0, 3 * layer);
+    int tail = (e.w * e.h) & 63;
+    uint64_t mask = tail ? ((uint64_t)1 << tail) - 1 : ~(uint64_t)0;
+    for (uint64_t *l = lvl->walls; l < lvl->scratch; l += words) l[words - 1] &= mask;
+
+    int boxes = 0, targets = 0;
+    for (int i = 0; i < words; i++) {
+        if (lvl->boxes[i] & lvl->walls[i]) return LEVEL_CORRUPT;
+        lvl->dead[i] &= ~lvl->walls[i];
+        boxes += BitCount(lvl->boxes[i]);
+        targets += BitCount(lvl->targets[i]);
+    }
+    int pc = e.py * e.w + e.px;
+    if (BB_TEST(lvl->walls, pc) || BB_TEST(lvl->boxes, pc)) return LEVEL_CORRUPT;
+    if (boxes != targets) return LEVEL_BOX_TARGET_MISMATCH;
+
+    lvl->px = e.px;
+    lvl->py = e.py;
+    LevelDerive(lvl);
+    lvl->deadlock = (DeadlockKind)e.deadlock;
+    return LEVEL_OK;
+}
+
+static bool BundleBlobAppend(BundleBlob *blob, const void *p, size_t n) {
+    return VerifyAppend(&blob->data, &blob->len, &blob->cap, p, n);
+}
+
+// Copy an RGBA8 image into a new section
+bool BundleWriterAddImage(BundleWriter *bw, uint32_t tag, const BundleImage *info, const void *pixels) {
+    if (bw->sectionCount == BUNDLE_MAX_SECTIONS - 1) return false;     // one slot stays for the levels
+    BundleBlob *blob = &bw->sections[bw->sectionCount];
+    blob->tag = tag;
+    if (!BundleBlobAppend(blob, info, sizeof(*info))
+        || !BundleBlobAppend(blob, pixels, (size_t)info->width * info->height * 4)) return false;
+    bw->sectionCount++;
+    return true;
+}
+
+// Append a loaded level (its current position is the start position)
+bool BundleWriterAddLevel(BundleWriter *bw, const Level *lvl, const char *title) {
+    if (bw->titles.len == 0 && !BundleBlobAppend(&bw->titles, "", 1)) return false;    // offset 0 = no title
+    BundleLevel e = {
+        .record = (uint32_t)bw->records.len,
+        .title = title && *title ? (uint32_t)bw->titles.len : 0,
+        .w = (uint16_t)lvl->w, .h = (uint16_t)lvl->h,
+        .px = (uint16_t)lvl->px, .py = (uint16_t)lvl->py,
+        .deadlock = (uint8_t)lvl->deadlock,
+    };
+    if (!BundleBlobAppend(&bw->records, lvl->walls, (size_t)lvl->words * 4 * sizeof(uint64_t))
+        || (e.title && !BundleBlobAppend(&bw->titles, title, strlen(title) + 1))
+        || !BundleBlobAppend(&bw->entries, &e, sizeof(e))) return false;
+    bw->levelCount++;
+    return true;
+}
+
+static bool BundleWritePadded(FILE *f, const void *p, size_t n) {
+    static const char zeros[8];
+    return fwrite(p, 1, n, f) == n && fwrite(zeros, 1, (8 - n % 8) % 8, f) == (8 - n % 8) % 8;
+}
+
+// Write the bundle to path.tmp, then rename it over path
+bool BundleWriterSave(const BundleWriter *bw, const char *path) {
+    BundleHeader hdr = { BUNDLE_MAGIC, BUNDLE_VERSION, (uint32_t)bw->sectionCount + (bw->levelCount > 0), 0 };
+    BundleSection table[BUNDLE_MAX_SECTIONS] = {{0}};
+    uint64_t at = sizeof(hdr) + hdr.sectionCount * sizeof(BundleSection);
+    for (int i = 0; i < bw->sectionCount; i++) {
+        table[i] = (BundleSection){ bw->sections[i].tag, 0, at, bw->sections[i].len };
+        at += (bw->sections[i].len + 7) / 8 * 8;
+    }
+    // Level section: count, entries, records, titles; entry offsets rebased to the section
+    uint32_t head[2] = { (uint32_t)bw->levelCount, 0 };
+    size_t recordsAt = sizeof(head) + bw->entries.len, titlesAt = recordsAt + bw->records.len;
+    if (bw->levelCount) table[bw->sectionCount] = (BundleSection){ BUNDLE_LEVELS, 0, at, titlesAt + bw->titles.len };
+
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return false;
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+           && fwrite(table, sizeof(BundleSection), hdr.sectionCount, f) == hdr.sectionCount;
+    for (int i = 0; ok && i < bw->sectionCount; i++) ok = BundleWritePadded(f, bw->sections[i].data, bw->sections[i].len);
+    if (bw->levelCount) {
+        ok = ok && fwrite(head, sizeof(head), 1, f) == 1;
+        for (int i = 0; ok && i < bw->levelCount; i++) {
+            BundleLevel e;
+            memcpy(&e, bw->entries.data + (size_t)i * sizeof(e), sizeof(e));
+            e.record += (uint32_t)recordsAt;
+            e.title += (uint32_t)titlesAt;
+            ok = fwrite(&e, sizeof(e), 1, f) == 1;
+        }
+        ok = ok && fwrite(bw->records.data, 1, bw->records.len, f) == bw->records.len
+                && BundleWritePadded(f, bw->titles.data, bw->titles.len);
+    }
+    ok = !ferror(f) && ok;
+    ok = fclose(f) == 0 && ok;
+    if (ok) {
+#if defined(_WIN32)
+        remove(path);       // rename does not replace on Windows
+#endif
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+void BundleWriterFree(BundleWriter *bw) {
+    for (int i = 0; i < BUNDLE_MAX_SECTIONS; i++) free(bw->sections[i].data);
+    free(bw->entries.data);
+    free(bw->records.data);
+    free(bw->titles.data);
+    memset(bw, 0, sizeof(*bw));
+}
+// ========================================================================
+
+// =================== [ Profiling ] ===================
+// Hot-path zones are timed only in builds with -DSOKOBAN_PROFILE (PROF_BEGIN
+// and PROF_END are empty otherwise); the game records its frame zone itself.
+// Counters are per thread. While a trace is recording, each zone timed on the
+// recording thread is also kept as an event for Chrome trace export.
+
+_Thread_local ProfCounters profCounters;
+
+typedef struct {
+    uint64_t start, ns;
+    ProfZone zone;
+} ProfEvent;
+
+#define PROF_TRACE_MAX (1 << 20)      // events kept per recording
+
+static ProfEvent *profTrace;
+static int profTraceCount;
+static _Thread_local bool profTracing;
+
+static const char *profZoneNames[PROF_ZONES] = { "Frame", "TryMove", "UndoMove", "LevelSolved", "DrawTiles" };
+
+const char *ProfZoneName(ProfZone zone) {
+    return profZoneNames[zone];
+}
+
+// Nanosecond timestamp (same clock as NowSeconds)
+uint64_t ProfNow(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void ProfRecord(ProfZone zone, uint64_t start, uint64_t ns) {
+    profCounters.ns[zone] += ns;
+    profCounters.calls[zone]++;
+    if (profTracing && profTraceCount < PROF_TRACE_MAX) {
+        ProfEvent e = { start, ns, zone };
+        profTrace[profTraceCount++] = e;
+    }
+}
+
+// Start keeping events from this thread; false when out of memory
+bool ProfTraceStart(void) {
+    if (!profTrace) profTrace = malloc(PROF_TRACE_MAX * sizeof(ProfEvent));
+    if (!profTrace) return false;
+    profTraceCount = 0;
+    profTracing = true;
+    return true;
+}
+
+// Stop recording and write the events as Chrome trace JSON (chrome://tracing
+// or Perfetto); returns the number of events written, -1 on I/O error
+int ProfTraceStop(const char *path) {
+    profTracing = false;
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    uint64_t base = UINT64_MAX;
+    for (int i = 0; i < profTraceCount; i++) if (profTrace[i].start < base) base = profTrace[i].start;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < profTraceCount; i++) {
+        const ProfEvent *e = &profTrace[i];
+        fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}\n",
+                i ? "," : "", profZoneNames[e->zone], (e->start - base) / 1e3, e->ns / 1e3);
+    }
+    fprintf(f, "]}\n");
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    return ok ? profTraceCount : -1;
+}
+// ========================================================================
+
+// Dispatch the headless modes; the game calls this before opening a window
+int RunHeadlessCli(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--solve") == 0)
+        return RunSolveCli(argc > 2 ? atoi(argv[2]) : 1);
+    if (argc > 1 && strcmp(argv[1], "--bench-heuristics") == 0)
+        return RunHeuristicBenchCli(argc > 2 ? argv[2] : NULL, argc > 3 ? atoll(argv[3]) : 0);
+    if (argc > 2 && strcmp(argv[1], "--solve-capped") == 0)
+        return RunCappedSolveCli(argv[2], argc > 3 ? atoi(argv[3]) : 1, argc > 4 ? atoll(argv[4]) : 0,
+                                 argc > 5 ? atoll(argv[5]) : 0, argc > 6 ? argv[6] : NULL);
+    if (argc > 1 && strcmp(argv[1], "--hint-latency") == 0)
+        return RunHintLatencyCli();
+    if (argc > 1 && strcmp(argv[1], "--bench-parallel") == 0)
+        return RunParallelBenchCli(argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? atoi(argv[3]) : 5,
+                                   argc > 4 ? argv[4] : NULL, argc > 5 ? atoll(argv[5]) : 0);
+    if (argc > 1 && strcmp(argv[1], "--bench-envs") == 0)
+        return RunEnvBenchCli(argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? atof(argv[3]) : 0, argc > 4 ? argv[4] : NULL);
+    if (argc > 1 && strcmp(argv[1], "--generate") == 0)
+        return RunGenerateCli(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--bench-snapshot") == 0)
+        return RunSnapshotBenchCli(argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? argv[3] : NULL);
+    if (argc > 1 && strcmp(argv[1], "--check-counters") == 0)
+        return RunCheckCountersCli(argc > 2 ? argv[2] : NULL, argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoi(argv[4]) : 0);
+    if (argc > 2 && strcmp(argv[1], "--validate") == 0)
+        return RunValidateCli(argv[2], argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoll(argv[4]) : 0, argc > 5 ? argv[5] : NULL);
+    if (argc > 3 && strcmp(argv[1], "--verify") == 0)
+        return RunVerifyCli(argv[2], argv[3], argc > 4 ? atoi(argv[4]) : 0);
+    return -1;
+}
@@ -0,0 +1,459 @@
+// Sokoban core: level model, move rules, history, LURD, packs and solvers.
+// Pure C11 with no raylib dependency, so the game, the benchmarks and the
+// headless tools all link the same code (see README for build lines).
+#ifndef SOKOBAN_H
+#define SOKOBAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define MAX_W 256                // largest level LoadLevel accepts; storage is sized per level
+#define MAX_H 256
+#define MOVELOG_CHECKPOINT 256   // moves between undo-log snapshots
+
+// Bundled level (NULL-terminated rows)
+extern const char *levelMap[];
+
+// Bitboards: one bit per cell, cell index = y*w + x (w = level width)
+#define BB_TEST(bb, i)  (((bb)[(i) >> 6] >> ((i) & 63)) & 1u)
+#define BB_SET(bb, i)   ((bb)[(i) >> 6] |= (uint64_t)1 << ((i) & 63))
+#define BB_CLEAR(bb, i) ((bb)[(i) >> 6] &= ~((uint64_t)1 << ((i) & 63)))
+
+// Index of the lowest set bit (v != 0)
+static inline int BitIndex(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return (int)i;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+// Index of the highest set bit (v must be non-zero)
+static inline int BitHighest(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return (int)i;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+// Number of set bits
+static inline int BitCount(uint64_t v) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+#define PULL_INF 0xFFFF
+
+// Direction order: up, down, left, right (same order as the arrow key handling);
+// d ^ 1 is the opposite direction
+static const int dirDX[4] = { 0, 0, -1, 1 };
+static const int dirDY[4] = { -1, 1, 0, 0 };
+
+typedef enum { DEADLOCK_NONE, DEADLOCK_DEAD_SQUARE, DEADLOCK_FREEZE, DEADLOCK_CORRAL } DeadlockKind;
+
+// A move is one byte: direction in the low bits, MOVE_PUSH when it pushed a box
+#define MOVE_DIR_MASK 3
+#define MOVE_PUSH 4
+
+// Undo/redo history. Moves are deterministic, so one byte per move is enough
+// to rebuild any position; a snapshot of the box layer and player every
+// MOVELOG_CHECKPOINT moves keeps long jumps through history fast.
+typedef struct {
+    unsigned char *moves;
+    int count;                  // moves recorded (including the redo tail)
+    int pos;                    // moves currently applied
+    int cap;
+
+    uint64_t *snaps;            // snapshot k = state after k*MOVELOG_CHECKPOINT moves
+    int snapCount;              // snapshots are (words + 1) words: boxes, then px | py << 32
+    size_t snapCap;             // capacity in words (levels of any size reuse the buffer)
+} MoveLog;
+
+// Level data
+typedef struct {
+    int w, h, words;        // words = 64-bit words per layer
+    int px, py;
+    int moveCount;          // same as log.pos
+
+    // Layers and tables below point into one arena sized by LoadLevel for
+    // this board; loading a level that fits reuses it (release with LevelFree)
+    // static layers (set by LoadLevel, never change while playing)
+    uint64_t *walls;
+    uint64_t *targets;
+    uint64_t *dead;             // floor cells no box can ever be pushed off to a target from
+    // dynamic layer; together with px/py this is the whole game state
+    uint64_t *boxes;
+    DeadlockKind deadlock;      // set once a push makes the level unsolvable
+
+    unsigned short *pullDist;   // scratch of the dead-square pass (pushes to bring a lone box home)
+    uint64_t *scratch;          // 3 layers of deadlock-check scratch (held, reachable, seen)
+    uint64_t *rowStart;         // first cell of every row (stops bit shifts wrapping between rows)
+    unsigned short *queue;      // per cell: BFS queue for deadlock checks
+    void *arena;
+    size_t arenaCap;
+
+    // kept up to date by LoadLevel/TryMove/UndoMove so checks are O(1)
+    int boxesOff, boxesOn;      // boxes off / on targets
+    uint64_t hash;              // Zobrist hash of box cells and the player cell
+
+    // undo/redo history (heap-owned: release with LevelFree)
+    MoveLog log;
+} Level;
+
+// Why a level could not be loaded
+typedef enum {
+    LEVEL_OK, LEVEL_EMPTY, LEVEL_TOO_BIG, LEVEL_BAD_CHAR,
+    LEVEL_NO_PLAYER, LEVEL_MANY_PLAYERS, LEVEL_BOX_TARGET_MISMATCH, LEVEL_NO_MEMORY,
+    LEVEL_CORRUPT
+} LevelStatus;
+
+// Outcome of replaying a LURD string (ReplayLurd)
+typedef enum {
+    REPLAY_SOLVED,           // every move legal and all boxes on targets at the end
+    REPLAY_UNSOLVED,         // every move legal, but boxes are left off target
+    REPLAY_ILLEGAL,          // a move was blocked, or its case disagreed with the board
+    REPLAY_BAD_CHAR,         // not a LURD string
+} ReplayStatus;
+
+typedef struct {
+    ReplayStatus status;
+    int moves, pushes;       // legal moves applied before stopping
+    int firstIllegal;        // 1-based number of the first illegal move, 0 if none
+} ReplayResult;
+
+// Streaming reader for XSB/.sok packs (PackOpen / PackNext / PackClose)
+#define PACK_MAX_ROWS 4096        // rows kept per level (bigger levels are still skipped cleanly)
+
+typedef struct {
+    FILE *f;
+    char *line;                   // current line, grown as needed
+    size_t lineCap;
+    int haveLine;                 // line holds an unconsumed board line
+    long lineNo;
+
+    char **rows;                  // rows of the level being read
+    int rowCount, rowCap;
+
+    char title[128];
+    char comment[128];            // last ';' comment, fallback title
+    int index;                    // 1-based number of the last level returned
+    long firstLine;               // line number where that level starts
+} PackReader;
+
+// Solver outcome; release steps with free()
+typedef struct {
+    int solved;              // 1 = solved, 0 = proven unsolvable, -1 = node limit hit
+    int pushes, moves;
+    long long expanded, generated;
+    double seconds;
+    size_t peakBytes;        // solver tables at their largest, RAM and spill file
+    size_t spillBytes;       // of which in the spill file
+    unsigned char *steps;    // malloc'd solution, one byte per step (dir | MOVE_PUSH)
+} SolveResult;
+
+// Lower bound guiding the A* solver (SolveLevelWith)
+typedef enum {
+    HEURISTIC_NEAREST,       // each box's pushes to its nearest target (default)
+    HEURISTIC_MANHATTAN,     // each box's grid distance to its nearest target
+    HEURISTIC_GREEDY,        // boxes paired with targets cheapest-first; may overestimate
+    HEURISTIC_MATCHING,      // min-cost box-target matching over push distances
+    HEURISTIC_COUNT
+} Heuristic;
+
+// SolveLevelOptions settings; zero-initialized means SolveLevel's defaults
+typedef struct {
+    Heuristic heuristic;
+    long long maxNodes;      // expansions, 0 = unlimited
+    size_t memoryBudget;     // bytes of tables kept in RAM, 0 = unlimited;
+                             // past it they spill to a mapped temporary file
+    const char *spillDir;    // where that file goes (NULL = $TMPDIR or /tmp)
+} SolveOptions;
+
+// Background hint engine (HintStart / HintPost / HintGet / HintStop)
+typedef enum {
+    HINT_NONE,               // no answer (searching, or beyond the solver)
+    HINT_GUESS,              // first push toward the most promising position so far
+    HINT_SOLVED,             // first push of an optimal solution (pushes 0 = already solved)
+    HINT_DEAD,               // no solution from here
+} HintStatus;
+
+typedef struct {
+    unsigned int query;      // HintPost this answers
+    HintStatus status;
+    int box, dir;            // push the box on cell `box` in direction dir (box < 0 = none)
+    int pushes;              // HINT_SOLVED: pushes left; HINT_GUESS: estimate
+    long long nodes;         // positions expanded for this query (0 = answered from memory)
+    int known;               // positions remembered from earlier queries
+    double firstMs;          // post to first answer, ms (< 0 = none yet)
+    double solvedMs;         // post to final answer, ms (< 0 = still searching)
+} Hint;
+
+typedef struct HintEngine HintEngine;
+
+// Full solve on a worker thread (SolveJobStart / SolveJobDone / SolveJobFinish)
+typedef struct SolveJob SolveJob;
+
+// Batched environments: many copies of levels stepped together (EnvBatchInit /
+// EnvBatchStep / EnvBatchReset). Per-environment state is one array per field,
+// indexed by environment, so a pass over the batch reads memory in order.
+typedef struct {
+    Level level;                // start position, as passed to EnvBatchInit
+    int32_t *next;              // next[c*4 + d]: cell one step from c in direction d (c = wall or edge)
+    uint64_t *zobrist;          // [c*2]: key of a box on c, [c*2 + 1]: of the player
+} EnvBoard;
+
+typedef struct {
+    int count;                  // environments
+    int words;                  // box layer stride (the largest board's words)
+    EnvBoard *boards;
+    int boardCount;
+
+    // per environment e; set board[e] before a reset to switch its level
+    int32_t *board;
+    int32_t *player;            // player cell, y * w + x
+    int32_t *boxesOff;          // same as Level.boxesOff
+    int32_t *moveCount, *pushCount;
+    uint64_t *hash;             // same as Level.hash
+    uint64_t *boxes;            // box layer of e at boxes + e * words
+    uint8_t *done;              // all boxes on targets (LevelSolved)
+    uint8_t *stuck;             // a box stands on a dead square: no way to win
+    void *arena;
+} EnvBatch;
+
+// GenerateLevels settings; zero-initialized means the defaults
+typedef struct {
+    int width, height;       // room including its outer wall (default 9 x 9, at most 64 x 64)
+    int boxes;               // default 3
+    int minDifficulty;       // band on GenScore.difficulty
+    int maxDifficulty;       // 0 = no upper limit
+    long long maxNodes;      // solver budget per candidate (default 100000)
+    int threads;             // default one per core
+    uint64_t seed;
+} GenOptions;
+
+// How hard a generated level is, from its push-optimal solution
+typedef struct {
+    int pushes, moves;
+    long long nodes;         // positions the solver expanded
+    int difficulty;          // pushes + moves / 8 + 4 * log2(1 + nodes)
+} GenScore;
+
+typedef struct {
+    int levels;              // written
+    long long candidates;    // rooms that got boxes pulled off their targets
+    long long gaveUp;        // solver budget ran out
+    long long failed;        // did not load, solve or replay: a generator bug
+    long long outOfBand, duplicates;
+    double seconds;
+} GenStats;
+
+// Save snapshot: which level, the board it belongs to and the whole move
+// history, enough to resume play where it stopped. The file is this header,
+// the history at 2 bits per move (directions; pushes follow from the board),
+// then a CRC-32 of everything before it. Integers are little-endian, fields
+// packed in this order (40 bytes) whatever the host's byte order.
+#define SNAPSHOT_MAGIC 0x56534B53u       // "SKSV"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version, headerSize;
+    uint32_t level;             // the caller's level number
+    uint32_t count, pos;        // moves recorded and applied (MoveLog count / pos)
+    uint32_t reserved;
+    uint64_t board;             // hash of the static layers (SnapshotBoardHash)
+    uint64_t hash;              // Level.hash after pos moves, checked on resume
+} SnapshotHeader;
+
+typedef enum {
+    SNAPSHOT_OK, SNAPSHOT_TRUNCATED, SNAPSHOT_BAD_MAGIC, SNAPSHOT_NEWER_VERSION,
+    SNAPSHOT_BAD_CHECKSUM, SNAPSHOT_OTHER_BOARD, SNAPSHOT_BAD_MOVES, SNAPSHOT_NO_MEMORY
+} SnapshotStatus;
+
+typedef struct SnapshotWriter SnapshotWriter;
+
+// Asset bundle: startup data baked at build time and memory-mapped by the
+// game. The file is a header, a section table, then 8-byte aligned sections;
+// all integers are little-endian. Nothing is parsed up front: images are
+// uploaded straight from the mapping and levels are decoded when loaded.
+#define BUNDLE_MAGIC 0x424B4F53u         // "SOKB"
+#define BUNDLE_VERSION 1
+#define BUNDLE_TAG(a, b, c, d) ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+#define BUNDLE_ATLAS  BUNDLE_TAG('A', 'T', 'L', 'S')    // tile atlas image
+#define BUNDLE_MENU   BUNDLE_TAG('M', 'E', 'N', 'U')    // menu background image
+#define BUNDLE_LEVELS BUNDLE_TAG('L', 'E', 'V', 'L')    // level table and records
+#define BUNDLE_MAX_SECTIONS 8
+
+typedef struct { uint32_t magic, version, sectionCount, reserved; } BundleHeader;
+typedef struct { uint32_t tag, reserved; uint64_t offset, size; } BundleSection;
+
+// Image section: this header, then width*height RGBA8 pixels
+typedef struct { uint32_t width, height, cellSize, cellCount; } BundleImage;
+
+// Level section: uint32 count and padding, count entries, then the records.
+// A record is the walls, targets, dead and boxes layers exactly as Level
+// stores them (words uint64 each), so loading one is a copy and no parsing.
+typedef struct {
+    uint32_t record, title;     // offsets within the section; title is NUL-terminated
+    uint16_t w, h, px, py;
+    uint8_t deadlock;           // LevelDeadlock of the start position
+    uint8_t reserved[7];
+} BundleLevel;
+
+typedef struct {
+    const unsigned char *data;  // the whole file, mapped read-only
+    size_t size;
+    const BundleSection *sections;
+    int sectionCount;
+    const unsigned char *levelData;     // level section
+    size_t levelBytes;
+    const BundleLevel *levels;
+    int levelCount;
+} Bundle;
+
+// Builds a bundle in memory (BundleWriterAdd*), then writes it in one go
+typedef struct { uint32_t tag; char *data; size_t len, cap; } BundleBlob;
+typedef struct {
+    BundleBlob sections[BUNDLE_MAX_SECTIONS];   // images, in the order added
+    int sectionCount;
+    BundleBlob entries, records, titles;        // level table, offsets not yet rebased
+    int levelCount;
+} BundleWriter;
+
+// =================== [ Levels and moves ] ===================
+LevelStatus LoadLevelRows(Level *lvl, const char **src, int rows);
+LevelStatus LoadLevel(Level *lvl, const char **src);
+bool LevelSolved(Level *lvl);
+void LevelFree(Level *lvl);
+bool LevelCopy(Level *dst, const Level *src);
+bool LevelCopyBoard(Level *dst, const Level *src);
+void TryMove(Level *lvl, int dx, int dy);
+void UndoMove(Level *lvl);
+bool RedoMove(Level *lvl);
+void JumpToMove(Level *lvl, int target);
+const char *LevelStatusText(LevelStatus st);
+
+// =================== [ Batched environments ] ===================
+bool EnvBatchInit(EnvBatch *eb, const Level *const *levels, int levelCount, int count);
+void EnvBatchFree(EnvBatch *eb);
+void EnvBatchReset(EnvBatch *eb, int begin, int end, const uint8_t *mask);
+int EnvBatchStep(EnvBatch *eb, int begin, int end, const uint8_t *actions, int8_t *result);
+void EnvBatchUndo(EnvBatch *eb, int e, int m);
+bool EnvBatchGet(const EnvBatch *eb, int e, Level *lvl);
+
+// =================== [ Level generator ] ===================
+int GenerateLevels(const GenOptions *opt, int count, FILE *out, GenStats *stats);
+
+// =================== [ Player reachability ] ===================
+// reach is a caller-owned layer (words uint64)
+void LevelReach(const Level *lvl, uint64_t *reach);
+int LevelNormalPlayer(const Level *lvl, uint64_t *reach);
+uint64_t LevelStateHash(const Level *lvl, uint64_t *reach);
+int LevelWalkPath(const Level *lvl, int to, unsigned char *out, int cap);
+int LevelPushPath(const Level *lvl, int box, int d, unsigned char *out, int cap);
+void LevelWalkDistances(const Level *lvl, unsigned short *dist, unsigned short *q);
+int LevelWalkPathFrom(const Level *lvl, const unsigned short *dist, int to, unsigned char *out, int cap);
+int LevelPushPathFrom(const Level *lvl, const unsigned short *dist, int box, int d, unsigned char *out, int cap);
+
+// =================== [ Deadlocks ] ===================
+DeadlockKind PushDeadlock(const Level *lvl, int c);
+DeadlockKind LevelDeadlock(const Level *lvl);
+const char *DeadlockText(DeadlockKind k);
+
+// =================== [ LURD ] ===================
+int LurdEncode(const unsigned char *moves, int count, char *out, size_t cap);
+int LurdDecode(const char *lurd, size_t len, unsigned char *out, int cap, size_t *badAt);
+ReplayStatus ReplayLurd(Level *lvl, const char *lurd, size_t len, ReplayResult *res);
+const char *ReplayStatusText(ReplayStatus st);
+
+// =================== [ Save snapshots ] ===================
+size_t SnapshotEncode(const Level *lvl, uint32_t level, unsigned char *out, size_t cap);
+SnapshotStatus SnapshotRead(const unsigned char *data, size_t size, SnapshotHeader *hdr);
+SnapshotStatus SnapshotApply(Level *lvl, const unsigned char *data, size_t size);
+uint64_t SnapshotBoardHash(const Level *lvl);
+const char *SnapshotStatusText(SnapshotStatus st);
+bool SnapshotSaveFile(const char *path, const void *data, size_t size);
+unsigned char *SnapshotLoadFile(const char *path, size_t *size);
+SnapshotWriter *SnapshotWriterStart(const char *path, double minInterval);
+bool SnapshotWriterPost(SnapshotWriter *sw, const Level *lvl, uint32_t level);
+int SnapshotWriterSaved(SnapshotWriter *sw, int *failed);
+void SnapshotWriterStop(SnapshotWriter *sw);
+
+// =================== [ Level packs ] ===================
+int PackOpen(PackReader *pr, const char *path);
+void PackClose(PackReader *pr);
+int PackNext(PackReader *pr, Level *lvl, LevelStatus *status);
+
+// =================== [ Asset bundle ] ===================
+bool BundleOpen(Bundle *b, const char *path);
+void BundleClose(Bundle *b);
+const void *BundleFind(const Bundle *b, uint32_t tag, size_t *size);
+const void *BundleImagePixels(const Bundle *b, uint32_t tag, BundleImage *info);
+LevelStatus LoadBundleLevel(Level *lvl, const Bundle *b, int index);
+const char *BundleLevelTitle(const Bundle *b, int index);
+bool BundleWriterAddImage(BundleWriter *bw, uint32_t tag, const BundleImage *info, const void *pixels);
+bool BundleWriterAddLevel(BundleWriter *bw, const Level *lvl, const char *title);
+bool BundleWriterSave(const BundleWriter *bw, const char *path);
+void BundleWriterFree(BundleWriter *bw);
+
+// =================== [ Solvers ] ===================
+int SolveLevel(const Level *lvl, long long maxNodes, SolveResult *res);
+int SolveLevelWith(const Level *lvl, Heuristic heuristic, long long maxNodes, SolveResult *res);
+int SolveLevelOptions(const Level *lvl, const SolveOptions *opt, SolveResult *res);
+const char *HeuristicName(Heuristic h);
+Heuristic HeuristicParse(const char *name);
+int SolveLevelParallel(const Level *lvl, int threads, long long maxNodes, SolveResult *res);
+int DefaultThreadCount(void);
+HintEngine *HintStart(long long maxNodes);
+unsigned int HintPost(HintEngine *he, const Level *lvl);
+bool HintGet(HintEngine *he, Hint *out);
+void HintStop(HintEngine *he);
+SolveJob *SolveJobStart(const Level *lvl, long long maxNodes);
+bool SolveJobDone(const SolveJob *job);
+int SolveJobFinish(SolveJob *job, SolveResult *res);
+double NowSeconds(void);
+
+// =================== [ Profiling ] ===================
+// Build with -DSOKOBAN_PROFILE to time the hot-path zones; in other builds
+// PROF_BEGIN/PROF_END compile to nothing.
+typedef enum { PROF_FRAME, PROF_TRY_MOVE, PROF_UNDO_MOVE, PROF_LEVEL_SOLVED, PROF_DRAW_TILES, PROF_ZONES } ProfZone;
+
+typedef struct {
+    uint64_t ns[PROF_ZONES];         // time per zone since the caller last cleared it
+    unsigned int calls[PROF_ZONES];
+} ProfCounters;
+
+extern _Thread_local ProfCounters profCounters;
+
+uint64_t ProfNow(void);
+void ProfRecord(ProfZone zone, uint64_t start, uint64_t ns);
+const char *ProfZoneName(ProfZone zone);
+bool ProfTraceStart(void);
+int ProfTraceStop(const char *path);
+
+#if defined(SOKOBAN_PROFILE)
+#define PROF_BEGIN(zone) uint64_t profStart_##zone = ProfNow()
+#define PROF_END(zone)   ProfRecord(zone, profStart_##zone, ProfNow() - profStart_##zone)
+#else
+#define PROF_BEGIN(zone) ((void)0)
+#define PROF_END(zone)   ((void)0)
+#endif
+
+// Headless command-line modes (--solve, --validate, ...). Returns the exit
+// code, or -1 when argv does not name a headless mode.
+int RunHeadlessCli(int argc, char **argv);
+
+#endif
@@ -0,0 +1,277 @@
+// Microbenchmarks for the Sokoban core (no window, no raylib).
+//
+//   sokoban_bench [seconds] [baseline.tsv]
+//
+// Prints one tab-separated line per benchmark and level: name, level,
+// operations, seconds and operations per second. Save the output of a release
+// and pass it back as the baseline to get a ratio column; the exit code is 3
+// when any benchmark runs below 80% of its baseline rate.
+#include "sokoban.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define BENCH_MAX 64
+#define BENCH_REGRESSION 0.8
+
+typedef struct {
+    const char *name;
+    const char **rows;        // NULL-terminated level rows
+    int bundleIndex;          // the same level in benchBundle (bundled in this order)
+} BenchLevel;
+
+typedef struct {
+    char name[32], level[32];
+    double rate;
+} BenchResult;
+
+static uint64_t benchRng = 0x2545F4914F6CDD1DULL;
+static Bundle benchBundle;       // every bench level, baked to BENCH_BUNDLE
+#define BENCH_BUNDLE "sokoban_bench.bundle"
+
+static uint32_t BenchRandom(void) {
+    benchRng ^= benchRng << 13;
+    benchRng ^= benchRng >> 7;
+    benchRng ^= benchRng << 17;
+    return (uint32_t)(benchRng >> 32);
+}
+
+// Random closed room of w x h with scattered walls and `boxes` boxes and
+// targets. Solvability does not matter here, only the size and box density.
+static const char **GenerateLevel(int w, int h, int boxes, uint64_t seed) {
+    benchRng = seed;
+    char **rows = calloc((size_t)h + 1, sizeof(char *));
+    if (!rows) return NULL;
+    for (int y = 0; y < h; y++) {
+        rows[y] = malloc((size_t)w + 1);
+        if (!rows[y]) return NULL;
+        for (int x = 0; x < w; x++) {
+            bool border = x == 0 || y == 0 || x == w - 1 || y == h - 1;
+            rows[y][x] = border || BenchRandom() % 100 < 12 ? '#' : ' ';
+        }
+        rows[y][w] = 0;
+    }
+    // Boxes and targets on free cells, kept off the border ring so most can move
+    for (int placed = 0, tries = 0; placed < 2 * boxes + 1 && tries < w * h * 16; tries++) {
+        int x = 2 + (int)(BenchRandom() % (unsigned)(w - 4)), y = 2 + (int)(BenchRandom() % (unsigned)(h - 4));
+        if (rows[y][x] != ' ') continue;
+        rows[y][x] = placed == 0 ? '@' : placed <= boxes ? '$' : '.';
+        placed++;
+    }
+    return (const char **)rows;
+}
+
+// Run fn(lvl, batch) until `seconds` have passed; returns operations per second
+typedef long long (*BenchFn)(Level *lvl, const BenchLevel *bl, long long batch);
+
+static long long BenchMoves(Level *lvl, const BenchLevel *bl, long long batch) {
+    (void)bl;
+    for (long long i = 0; i < batch; i++) {
+        int d = (int)(BenchRandom() & 3);
+        TryMove(lvl, dirDX[d], dirDY[d]);
+    }
+    return batch;
+}
+
+static long long BenchUndos(Level *lvl, const BenchLevel *bl, long long batch) {
+    (void)bl;
+    // Undo the whole history, then jump back to its end. The jump restores a
+    // snapshot and replays under MOVELOG_CHECKPOINT moves, a few percent of the time.
+    long long n = 0;
+    while (n < batch) {
+        int applied = lvl->log.pos;
+        for (int i = 0; i < applied && n < batch; i++, n++) UndoMove(lvl);
+        JumpToMove(lvl, applied);
+    }
+    return n;
+}
+
+static long long BenchLoads(Level *lvl, const BenchLevel *bl, long long batch) {
+    for (long long i = 0; i < batch; i++) LoadLevel(lvl, bl->rows);
+    return batch;
+}
+
+static long long BenchBundleLoads(Level *lvl, const BenchLevel *bl, long long batch) {
+    for (long long i = 0; i < batch; i++) LoadBundleLevel(lvl, &benchBundle, bl->bundleIndex);
+    return batch;
+}
+
+static long long BenchReach(Level *lvl, const BenchLevel *bl, long long batch) {
+    (void)bl;
+    for (long long i = 0; i < batch; i++) LevelReach(lvl, lvl->scratch + lvl->words);
+    return batch;
+}
+
+// Walks to random cells, reachable or not (hover previews ask for both)
+static long long BenchWalkPaths(Level *lvl, const BenchLevel *bl, long long batch) {
+    (void)bl;
+    int cells = lvl->w * lvl->h;
+    for (long long i = 0; i < batch; i++) LevelWalkPath(lvl, (int)(BenchRandom() % (unsigned)cells), NULL, 0);
+    return batch;
+}
+
+// Walk-distance maps of the position (the game builds one per position)
+static unsigned short benchDist[MAX_W * MAX_H], benchQueue[MAX_W * MAX_H];
+static unsigned char benchPath[MAX_W * MAX_H];
+
+static long long BenchWalkMaps(Level *lvl, const BenchLevel *bl, long long batch) {
+    (void)bl;
+    for (long long i = 0; i < batch; i++) LevelWalkDistances(lvl, benchDist, benchQueue);
+    return batch;
+}
+
+// Paths to random cells traced off one map, as hover previews are
+static long long BenchWalkTraces(Level *lvl, const BenchLevel *bl, long long batch) {
+    (void)bl;
+    static uint64_t mapped;
+    if (mapped != lvl->hash) {
+        LevelWalkDistances(lvl, benchDist, benchQueue);
+        mapped = lvl->hash;
+    }
+    int cells = lvl->w * lvl->h;
+    for (long long i = 0; i < batch; i++)
+        LevelWalkPathFrom(lvl, benchDist, (int)(BenchRandom() % (unsigned)cells), benchPath, cells);
+    return batch;
+}
+
+static long long BenchWinChecks(Level *lvl, const BenchLevel *bl, long long batch) {
+    (void)bl;
+    volatile int solved = 0;
+    for (long long i = 0; i < batch; i++) solved += LevelSolved(lvl);
+    return batch;
+}
+
+// Random actions for 1024 batched copies of the level (EnvBatchStep). The
+// batch is built once per level, from the position the level is in then.
+static EnvBatch benchEnvs;
+static const BenchLevel *benchEnvsLevel;
+
+static long long BenchEnvSteps(Level *lvl, const BenchLevel *bl, long long batch) {
+    enum { ENVS = 1024 };
+    static uint8_t actions[ENVS];
+    if (benchEnvsLevel != bl) {
+        const Level *start = lvl;
+        EnvBatchFree(&benchEnvs);
+        benchEnvsLevel = EnvBatchInit(&benchEnvs, &start, 1, ENVS) ? bl : NULL;
+        if (!benchEnvsLevel) return 0;
+    }
+    long long n = 0;
+    while (n < batch) {
+        for (int e = 0; e < ENVS; e++) actions[e] = (uint8_t)(BenchRandom() & 3);
+        if (EnvBatchStep(&benchEnvs, 0, ENVS, actions, NULL)) EnvBatchReset(&benchEnvs, 0, ENVS, benchEnvs.done);
+        n += ENVS;
+    }
+    return n;
+}
+
+static double BenchRun(BenchFn fn, Level *lvl, const BenchLevel *bl, double seconds, long long *opsOut, double *secsOut) {
+    long long batch = 1024, ops = 0;
+    double t0 = NowSeconds(), elapsed = 0;
+    while (elapsed < seconds) {
+        ops += fn(lvl, bl, batch);
+        elapsed = NowSeconds() - t0;
+        if (batch < (1LL << 24) && elapsed < seconds / 8) batch *= 2;
+    }
+    *opsOut = ops;
+    *secsOut = elapsed;
+    return elapsed > 0 ? ops / elapsed : 0;
+}
+
+// Read "name level ops seconds rate" lines from an earlier run
+static int LoadBaseline(const char *path, BenchResult *out, int cap) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[256];
+    int n = 0;
+    while (n < cap && fgets(line, sizeof(line), f)) {
+        long long ops;
+        double secs;
+        if (sscanf(line, "%31s %31s %lld %lf %lf", out[n].name, out[n].level, &ops, &secs, &out[n].rate) == 5) n++;
+    }
+    fclose(f);
+    return n;
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+    if (seconds <= 0) seconds = 0.5;
+    BenchResult baseline[BENCH_MAX];
+    int baselineCount = 0;
+    if (argc > 2) {
+        baselineCount = LoadBaseline(argv[2], baseline, BENCH_MAX);
+        if (baselineCount < 0) { fprintf(stderr, "cannot open %s\n", argv[2]); return 1; }
+    }
+
+    BenchLevel levels[] = {
+        { "bundled", levelMap, 0 },
+        { "gen12x12", GenerateLevel(12, 12, 6, 1), 1 },
+        { "gen20x20", GenerateLevel(20, 20, 24, 2), 2 },
+        { "gen64x64", GenerateLevel(64, 64, 160, 3), 3 },
+        { "gen256x256", GenerateLevel(MAX_W, MAX_H, 1200, 4), 4 },
+    };
+    struct { const char *name; BenchFn fn; } benches[] = {
+        { "moves", BenchMoves },
+        { "undos", BenchUndos },
+        { "loads", BenchLoads },
+        { "bundle_loads", BenchBundleLoads },
+        { "reach", BenchReach },
+        { "walk_paths", BenchWalkPaths },
+        { "walk_maps", BenchWalkMaps },
+        { "walk_traces", BenchWalkTraces },
+        { "win_checks", BenchWinChecks },
+        { "env_steps", BenchEnvSteps },
+    };
+    int levelCount = (int)(sizeof(levels) / sizeof(levels[0]));
+    int benchCount = (int)(sizeof(benches) / sizeof(benches[0]));
+
+    printf("bench\tlevel\tops\tseconds\tops_per_sec%s\n", baselineCount ? "\tvs_baseline" : "");
+    int regressions = 0;
+    Level *lvl = calloc(1, sizeof(Level));
+    if (!lvl) return 1;
+    BundleWriter bw = {0};
+    for (int l = 0; l < levelCount; l++) {
+        if (!levels[l].rows || LoadLevel(lvl, levels[l].rows) != LEVEL_OK || !BundleWriterAddLevel(&bw, lvl, levels[l].name)) {
+            fprintf(stderr, "level %s did not load\n", levels[l].name);
+            LevelFree(lvl);
+            free(lvl);
+            return 1;
+        }
+    }
+    bool baked = BundleWriterSave(&bw, BENCH_BUNDLE) && BundleOpen(&benchBundle, BENCH_BUNDLE);
+    BundleWriterFree(&bw);
+    if (!baked) {
+        fprintf(stderr, "cannot write %s\n", BENCH_BUNDLE);
+        return 1;
+    }
+    for (int l = 0; l < levelCount; l++) {
+        for (int b = 0; b < benchCount; b++) {
+            // Every benchmark starts from the same position with 4096 moves of history
+            benchRng = 0x9E3779B97F4A7C15ULL + (uint64_t)l;
+            LoadLevel(lvl, levels[l].rows);
+            BenchMoves(lvl, &levels[l], 4096);
+
+            long long ops;
+            double secs;
+            double rate = BenchRun(benches[b].fn, lvl, &levels[l], seconds, &ops, &secs);
+            printf("%s\t%s\t%lld\t%.4f\t%.0f", benches[b].name, levels[l].name, ops, secs, rate);
+            for (int i = 0; i < baselineCount; i++) {
+                if (strcmp(baseline[i].name, benches[b].name) || strcmp(baseline[i].level, levels[l].name)) continue;
+                double ratio = baseline[i].rate > 0 ? rate / baseline[i].rate : 0;
+                printf("\t%.3f", ratio);
+                if (ratio < BENCH_REGRESSION) regressions++;
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    LevelFree(lvl);
+    free(lvl);
+    EnvBatchFree(&benchEnvs);
+    BundleClose(&benchBundle);
+    remove(BENCH_BUNDLE);
+    for (int l = 1; l < levelCount; l++) {
+        for (int y = 0; levels[l].rows && levels[l].rows[y]; y++) free((char *)levels[l].rows[y]);
+        free((char **)levels[l].rows);
+    }
+    if (regressions) fprintf(stderr, "%d benchmark(s) below %.0f%% of baseline\n", regressions, BENCH_REGRESSION * 100);
+    return regressions ? 3 : 0;
+}
@@ -0,0 +1,701 @@
+// Headless game server: many independent games behind one local socket, for
+// tournaments and bot matches (no window, no raylib).
+//
+//   sokoban_server --serve ADDR [pack.xsb] [maxSessions]
+//   sokoban_server --load-test ADDR [sessions] [seconds] [movesPerSec]
+//
+// ADDR is unix:/path/to/socket or tcp:PORT (bound to 127.0.0.1 only). Every
+// connection is one session. Commands and replies are single text lines;
+// replies start with "ok" or "err <reason>":
+//
+//   load N        start level N (1-based) of the pack  -> ok N
+//   move LURD     step in each direction (u/d/l/r, any case) until one is
+//                 blocked -> ok <applied> <moves> <solved>
+//   undo [N]      take back N moves (default 1)        -> ok <undone> <moves>
+//   state         -> ok <moves> <pushes> <boxesOff> <solved> <stuck> <rows>
+//                 rows in XSB, separated by '|'
+//   solved        -> ok 1 | ok 0
+//   levels        -> ok <count>
+//   stats         -> ok <sessions> <cpuSeconds> <commands>
+//   quit          close the connection
+//
+// One thread serves everything from a poll() loop. Each wakeup reads once
+// from every ready connection, runs all complete commands it received and
+// answers each connection with one send. Every session's commands run in
+// order, and the move letters pending across all of them are stepped
+// together: one EnvBatchStep per letter position. Games live in a core
+// EnvBatch (see sokoban.h): a session is a slot there plus its move bytes
+// for undo, tens of bytes instead of a whole Level. The load test opens one connection per session,
+// sends paced random moves and prints latency percentiles, along with how
+// many such sessions one server core would carry.
+#define _POSIX_C_SOURCE 200809L
+#include "sokoban.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <stdarg.h>
+
+#if defined(_WIN32)
+int main(void) {
+    fprintf(stderr, "sokoban_server needs POSIX sockets and poll()\n");
+    return 1;
+}
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0              // SIGPIPE is ignored instead
+#endif
+
+#define SERVER_READ_SIZE 65536
+#define SERVER_MAX_LINE 65536       // longer commands are refused
+#define SERVER_SESSIONS 10000
+#define SERVER_STAND 4              // EnvBatchStep action that leaves a session where it is
+
+// =================== [ Sockets ] ===================
+
+static int SetNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Thousands of sessions need thousands of descriptors: lift the soft limit
+static void RaiseFileLimit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+// Socket address for "unix:/path" or "tcp:PORT"; 0 when ADDR is neither
+static socklen_t ParseAddress(const char *addr, struct sockaddr_storage *ss) {
+    memset(ss, 0, sizeof(*ss));
+    if (strncmp(addr, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)ss;
+        if (strlen(addr + 5) >= sizeof(un->sun_path)) return 0;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, addr + 5);
+        return sizeof(*un);
+    }
+    if (strncmp(addr, "tcp:", 4) == 0) {
+        struct sockaddr_in *in = (struct sockaddr_in *)ss;
+        int port = atoi(addr + 4);
+        if (port <= 0 || port > 65535) return 0;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)port);
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return sizeof(*in);
+    }
+    return 0;
+}
+
+static int OpenListener(const char *addr) {
+    struct sockaddr_storage ss;
+    socklen_t len = ParseAddress(addr, &ss);
+    if (!len) return -1;
+    int fd = socket(ss.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    if (ss.ss_family == AF_UNIX) unlink(((struct sockaddr_un *)&ss)->sun_path);
+    else setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&ss, len) != 0 || listen(fd, SOMAXCONN) != 0 || SetNonBlocking(fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Blocking connect, then non-blocking from there on
+static int ConnectTo(const char *addr) {
+    struct sockaddr_storage ss;
+    socklen_t len = ParseAddress(addr, &ss);
+    if (!len) return -1;
+    int fd = socket(ss.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    if (ss.ss_family == AF_INET) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr *)&ss, len) != 0 || SetNonBlocking(fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Grow a byte buffer to hold at least need bytes; false when out of memory
+static bool Reserve(char **buf, int *cap, int need) {
+    if (need <= *cap) return true;
+    int n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    char *p = realloc(*buf, (size_t)n);
+    if (!p) return false;
+    *buf = p;
+    *cap = n;
+    return true;
+}
+// ========================================================================
+
+// =================== [ Server ] ===================
+
+typedef struct {
+    int env;                    // EnvBatch slot, -1 = no level loaded
+    unsigned char *moves;       // move bytes made, for undo (eb.moveCount[env] of them)
+    int movesCap;
+    char *in;                   // received and not yet run: whole lines, then maybe the start of one
+    int inLen, inCap, partialLen;   // partialLen: bytes after the last newline
+    int inPos, lineEnd;         // first byte not yet run, end of the line being run
+    int step, applied;          // move in progress: offset of its next letter (-1 = none), moves made
+    bool closing;
+    char *out;                  // replies the socket has not taken yet
+    int outLen, outCap;
+} Conn;
+
+typedef struct {
+    EnvBatch eb;
+    int *freeEnvs, freeCount;
+    uint8_t *actions;           // EnvBatchStep arguments, one per slot, SERVER_STAND between steps
+    int8_t *results;
+    struct pollfd *pfds;        // [0] is the listener, [i] belongs to conns[i]
+    Conn *conns;
+    int *ready;                 // this round's connections, highest index first
+    int *running;               // the ones still running commands, for ServerRun
+    int count, cap;
+    long long commands;
+    char *read;                 // SERVER_READ_SIZE bytes
+} Server;
+
+static volatile sig_atomic_t serverStop;
+
+static void OnStopSignal(int sig) {
+    (void)sig;
+    serverStop = 1;
+}
+
+static void Reply(Conn *c, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void Reply(Conn *c, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0 || !Reserve(&c->out, &c->outCap, c->outLen + n + 1)) return;
+    va_start(ap, fmt);
+    vsnprintf(c->out + c->outLen, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    c->outLen += n;
+}
+
+static double CpuSeconds(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// The session's board in XSB, rows separated by '|'
+static void ReplyBoard(Server *sv, Conn *c) {
+    const EnvBatch *eb = &sv->eb;
+    int e = c->env;
+    const Level *b = &eb->boards[eb->board[e]].level;
+    const uint64_t *bx = eb->boxes + (size_t)e * eb->words;
+    if (!Reserve(&c->out, &c->outCap, c->outLen + b->h * (b->w + 1) + 1)) return;
+    char *out = c->out + c->outLen;
+    for (int y = 0; y < b->h; y++) {
+        if (y) *out++ = '|';
+        for (int x = 0; x < b->w; x++) {
+            int c = y * b->w + x;
+            bool target = BB_TEST(b->targets, c);
+            if (BB_TEST(b->walls, c)) *out++ = '#';
+            else if (c == eb->player[e]) *out++ = target ? '+' : '@';
+            else if (BB_TEST(bx, c)) *out++ = target ? '*' : '$';
+            else *out++ = target ? '.' : ' ';
+        }
+    }
+    *out = 0;
+    c->outLen = (int)(out - c->out);
+}
+
+static int LetterDirection(int ch) {
+    switch (tolower(ch)) {
+        case 'u': return 0; case 'd': return 1; case 'l': return 2; case 'r': return 3;
+        default: return -1;
+    }
+}
+
+// Run one command line (without its newline); false to close the connection.
+// A move only records where its letters start: ConnRun steps them.
+static bool ServeCommand(Server *sv, Conn *c, char *line) {
+    EnvBatch *eb = &sv->eb;
+    sv->commands++;
+    char *arg = line;
+    while (*arg && *arg != ' ') arg++;
+    if (*arg) *arg++ = 0;
+    while (*arg == ' ') arg++;
+    int e = c->env;
+
+    if (strcmp(line, "quit") == 0) return false;
+    if (strcmp(line, "levels") == 0) { Reply(c, "ok %d\n", eb->boardCount); return true; }
+    if (strcmp(line, "stats") == 0) {
+        Reply(c, "ok %d %.3f %lld\n", eb->count - sv->freeCount, CpuSeconds(), sv->commands);
+        return true;
+    }
+    if (strcmp(line, "load") == 0) {
+        int n = atoi(arg);
+        if (n < 1 || n > eb->boardCount) { Reply(c, "err no such level\n"); return true; }
+        if (e < 0) {
+            if (!sv->freeCount) { Reply(c, "err server full\n"); return true; }
+            e = c->env = sv->freeEnvs[--sv->freeCount];
+        }
+        eb->board[e] = n - 1;
+        EnvBatchReset(eb, e, e + 1, NULL);
+        Reply(c, "ok %d\n", n);
+        return true;
+    }
+    if (e < 0) {
+        bool known = !strcmp(line, "move") || !strcmp(line, "undo") || !strcmp(line, "state") || !strcmp(line, "solved");
+        Reply(c, known ? "err no level\n" : "err unknown command\n");
+        return true;
+    }
+    if (strcmp(line, "move") == 0) {
+        c->step = (int)(arg - c->in);
+        c->applied = 0;
+    } else if (strcmp(line, "undo") == 0) {
+        int n = *arg ? atoi(arg) : 1, undone = 0;
+        for (; undone < n && eb->moveCount[e] > 0; undone++) EnvBatchUndo(eb, e, c->moves[eb->moveCount[e] - 1]);
+        Reply(c, "ok %d %d\n", undone, eb->moveCount[e]);
+    } else if (strcmp(line, "state") == 0) {
+        Reply(c, "ok %d %d %d %d %d ", eb->moveCount[e], eb->pushCount[e], eb->boxesOff[e], eb->done[e], eb->stuck[e]);
+        ReplyBoard(sv, c);
+        Reply(c, "\n");
+    } else if (strcmp(line, "solved") == 0) {
+        Reply(c, "ok %d\n", eb->done[e]);
+    } else {
+        Reply(c, "err unknown command\n");
+    }
+    return true;
+}
+
+// Run the connection's commands in order up to its next move letter. True
+// when that letter is waiting in sv->actions for the next batched step.
+static bool ConnRun(Server *sv, Conn *c) {
+    EnvBatch *eb = &sv->eb;
+    for (;;) {
+        if (c->step >= 0) {
+            int e = c->env;
+            // The line's terminator is no direction, so this ends every move
+            int d = LetterDirection(c->in[c->step]);
+            if (d >= 0 && Reserve((char **)&c->moves, &c->movesCap, eb->moveCount[e] + 1)) {
+                sv->actions[e] = (uint8_t)d;
+                return true;
+            }
+            Reply(c, "ok %d %d %d\n", c->applied, eb->moveCount[e], eb->done[e]);
+            c->step = -1;
+            c->inPos = c->lineEnd;
+        }
+        char *line = c->in + c->inPos;
+        char *nl = c->closing ? NULL : memchr(line, '\n', (size_t)(c->inLen - c->inPos));
+        if (!nl) return false;
+        int lineLen = (int)(nl - line);
+        c->lineEnd = c->inPos + lineLen + 1;
+        if (lineLen && line[lineLen - 1] == '\r') lineLen--;
+        line[lineLen] = 0;
+        if (!ServeCommand(sv, c, line)) { c->closing = true; return false; }
+        if (c->step < 0) c->inPos = c->lineEnd;
+    }
+}
+
+// Take the result of the step ConnRun asked for
+static void ConnStepped(Server *sv, Conn *c) {
+    EnvBatch *eb = &sv->eb;
+    int e = c->env, m = sv->results[e];
+    sv->actions[e] = SERVER_STAND;
+    if (m < 0) {
+        c->step = c->lineEnd - 1;           // blocked: ConnRun answers the move
+        return;
+    }
+    c->moves[eb->moveCount[e] - 1] = (unsigned char)m;
+    c->applied++;
+    c->step++;
+}
+
+// Run everything this round's connections received. Each pass steps every
+// session that has a move letter waiting with one EnvBatchStep over the slots
+// they span (sessions take the lowest free slot, so the span stays dense);
+// a session with several letters takes part in as many passes.
+static void ServerRun(Server *sv, int readyCount) {
+    int *running = sv->running;
+    memcpy(running, sv->ready, (size_t)readyCount * sizeof(int));
+    int count = readyCount;
+    while (count) {
+        int lo = sv->eb.count, hi = -1, n = 0;
+        for (int k = 0; k < count; k++) {
+            Conn *c = &sv->conns[running[k]];
+            if (!ConnRun(sv, c)) continue;
+            running[n++] = running[k];
+            if (c->env < lo) lo = c->env;
+            if (c->env > hi) hi = c->env;
+        }
+        count = n;
+        if (!count) break;
+        EnvBatchStep(&sv->eb, lo, hi + 1, sv->actions, sv->results);
+        for (int k = 0; k < count; k++) ConnStepped(sv, &sv->conns[running[k]]);
+    }
+}
+
+// Send what the connection has waiting; whatever the socket does not take
+// waits for POLLOUT. Run input is dropped and idle connections keep no buffers.
+static bool ConnFlush(Server *sv, int i) {
+    Conn *c = &sv->conns[i];
+    if (c->inPos) {
+        memmove(c->in, c->in + c->inPos, (size_t)(c->inLen - c->inPos));
+        c->inLen -= c->inPos;
+        c->inPos = 0;
+    }
+    if (!c->inLen && c->in) { free(c->in); c->in = NULL; c->inCap = 0; }
+    if (c->outLen) {
+        ssize_t n = send(sv->pfds[i].fd, c->out, (size_t)c->outLen, MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+        if (n > 0) {
+            memmove(c->out, c->out + n, (size_t)(c->outLen - n));
+            c->outLen -= (int)n;
+        }
+    }
+    if (!c->outLen && c->outCap > 4096) { free(c->out); c->out = NULL; c->outCap = 0; }
+    sv->pfds[i].events = (short)(POLLIN | (c->outLen ? POLLOUT : 0));
+    return true;
+}
+
+// Queue received bytes behind what the connection has not run yet
+static bool ConnFeed(Conn *c, const char *data, int len) {
+    if (!Reserve(&c->in, &c->inCap, c->inLen + len + 1)) return false;
+    memcpy(c->in + c->inLen, data, (size_t)len);
+    c->inLen += len;
+    // Refuse an unfinished line that has grown too long
+    int i = len;
+    while (i > 0 && data[i - 1] != '\n') i--;
+    c->partialLen = i ? len - i : c->partialLen + len;
+    return c->partialLen <= SERVER_MAX_LINE;
+}
+
+static void ConnClose(Server *sv, int i) {
+    Conn *c = &sv->conns[i];
+    close(sv->pfds[i].fd);
+    if (c->env >= 0) sv->freeEnvs[sv->freeCount++] = c->env;
+    free(c->moves);
+    free(c->in);
+    free(c->out);
+    // Keep the arrays dense: the last connection takes this slot
+    sv->count--;
+    sv->conns[i] = sv->conns[sv->count];
+    sv->pfds[i] = sv->pfds[sv->count];
+}
+
+static void ServerAccept(Server *sv) {
+    for (;;) {
+        int fd = accept(sv->pfds[0].fd, NULL, NULL);
+        if (fd < 0) return;
+        if (SetNonBlocking(fd) != 0) { close(fd); continue; }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));    // fails harmlessly on Unix sockets
+        if (sv->count == sv->cap) {
+            int cap = sv->cap * 2;
+            struct pollfd *pfds = realloc(sv->pfds, (size_t)cap * sizeof(*pfds));
+            if (pfds) sv->pfds = pfds;
+            Conn *conns = pfds ? realloc(sv->conns, (size_t)cap * sizeof(*conns)) : NULL;
+            if (conns) sv->conns = conns;
+            int *ready = conns ? realloc(sv->ready, (size_t)cap * sizeof(*ready)) : NULL;
+            if (ready) sv->ready = ready;
+            int *running = ready ? realloc(sv->running, (size_t)cap * sizeof(*running)) : NULL;
+            if (!running) { close(fd); return; }
+            sv->running = running;
+            sv->cap = cap;
+        }
+        sv->pfds[sv->count] = (struct pollfd){ fd, POLLIN, 0 };
+        sv->conns[sv->count] = (Conn){ .env = -1, .step = -1 };
+        sv->count++;
+    }
+}
+
+static int RunServer(const char *addr, const char *pack, int maxSessions) {
+    if (maxSessions < 1) maxSessions = SERVER_SESSIONS;
+    Level **levels = NULL;
+    int levelCount = 0;
+    Level *lvl = calloc(1, sizeof(Level));
+    if (pack) {
+        PackReader pr;
+        LevelStatus st;
+        if (!PackOpen(&pr, pack)) { fprintf(stderr, "cannot open %s\n", pack); free(lvl); return 1; }
+        while (lvl && PackNext(&pr, lvl, &st)) {
+            if (st != LEVEL_OK) continue;
+            Level **grown = realloc(levels, (size_t)(levelCount + 1) * sizeof(Level *));
+            if (!grown) break;
+            levels = grown;
+            levels[levelCount++] = lvl;
+            lvl = calloc(1, sizeof(Level));
+        }
+        PackClose(&pr);
+    } else if (lvl && (levels = malloc(sizeof(Level *))) && LoadLevel(lvl, levelMap) == LEVEL_OK) {
+        levels[levelCount++] = lvl;
+        lvl = NULL;
+    }
+    if (lvl) { LevelFree(lvl); free(lvl); }
+
+    Server sv = {0};
+    int code = 0;
+    if (!levelCount || !EnvBatchInit(&sv.eb, (const Level *const *)levels, levelCount, maxSessions)) {
+        fprintf(stderr, "no levels\n");
+        code = 1;
+    }
+    sv.freeEnvs = malloc((size_t)maxSessions * sizeof(int));
+    sv.actions = malloc((size_t)maxSessions);
+    sv.results = malloc((size_t)maxSessions);
+    sv.cap = 1024;
+    sv.pfds = malloc((size_t)sv.cap * sizeof(struct pollfd));
+    sv.conns = malloc((size_t)sv.cap * sizeof(Conn));
+    sv.ready = malloc((size_t)sv.cap * sizeof(int));
+    sv.running = malloc((size_t)sv.cap * sizeof(int));
+    sv.read = malloc(SERVER_READ_SIZE + 1);
+    if (!code && (!sv.freeEnvs || !sv.actions || !sv.results || !sv.pfds || !sv.conns || !sv.ready || !sv.running || !sv.read)) { fprintf(stderr, "out of memory\n"); code = 1; }
+    int listenFd = code ? -1 : OpenListener(addr);
+    if (!code && listenFd < 0) { fprintf(stderr, "cannot listen on %s (use unix:/path or tcp:PORT)\n", addr); code = 1; }
+
+    if (!code) {
+        for (int e = 0; e < maxSessions; e++) sv.freeEnvs[sv.freeCount++] = maxSessions - 1 - e;
+        memset(sv.actions, SERVER_STAND, (size_t)maxSessions);
+        sv.pfds[0] = (struct pollfd){ listenFd, POLLIN, 0 };
+        sv.conns[0] = (Conn){ .env = -1, .step = -1 };
+        sv.count = 1;
+        struct sigaction sa = {0};
+        sa.sa_handler = OnStopSignal;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        signal(SIGPIPE, SIG_IGN);
+        RaiseFileLimit();
+        size_t slot = (size_t)sv.eb.words * 8 + 8 + 5 * 4 + 2;
+        printf("serving %d levels on %s, up to %d sessions\n", levelCount, addr, maxSessions);
+        printf("per session: %zu bytes of game state + %zu of connection + 1 byte per move (a Level is %zu + %zu)\n",
+               slot, sizeof(Conn), sizeof(Level), levels[0]->arenaCap);
+        fflush(stdout);
+
+        while (!serverStop) {
+            if (poll(sv.pfds, (nfds_t)sv.count, -1) < 0) {
+                if (errno == EINTR) continue;
+                perror("poll");
+                code = 1;
+                break;
+            }
+            if (sv.pfds[0].revents & POLLIN) ServerAccept(&sv);
+            int readyCount = 0;
+            for (int i = sv.count - 1; i >= 1; i--) {
+                short rev = sv.pfds[i].revents;
+                if (!rev) continue;
+                sv.pfds[i].revents = 0;
+                Conn *c = &sv.conns[i];
+                c->closing = rev & (POLLERR | POLLNVAL);
+                if (!c->closing && (rev & (POLLIN | POLLHUP))) {
+                    ssize_t n = recv(sv.pfds[i].fd, sv.read, SERVER_READ_SIZE, 0);
+                    if (n > 0) c->closing = !ConnFeed(c, sv.read, (int)n);
+                    else c->closing = !(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+                }
+                sv.ready[readyCount++] = i;
+            }
+            ServerRun(&sv, readyCount);
+            // Highest index first, so a closed connection's slot is refilled from one already flushed.
+            // One send for everything this round produced, even when closing.
+            for (int k = 0; k < readyCount; k++) {
+                int i = sv.ready[k];
+                if (!ConnFlush(&sv, i) || sv.conns[i].closing) ConnClose(&sv, i);
+            }
+        }
+        printf("stopped after %lld commands, %.2f s of CPU\n", sv.commands, CpuSeconds());
+    }
+    for (int i = 1; i < sv.count; i++) {
+        close(sv.pfds[i].fd);
+        free(sv.conns[i].moves);
+        free(sv.conns[i].in);
+        free(sv.conns[i].out);
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+        if (strncmp(addr, "unix:", 5) == 0) unlink(addr + 5);
+    }
+    EnvBatchFree(&sv.eb);
+    free(sv.freeEnvs);
+    free(sv.actions);
+    free(sv.results);
+    free(sv.pfds);
+    free(sv.conns);
+    free(sv.ready);
+    free(sv.running);
+    free(sv.read);
+    for (int l = 0; l < levelCount; l++) { LevelFree(levels[l]); free(levels[l]); }
+    free(levels);
+    return code;
+}
+// ========================================================================
+
+// =================== [ Load generator ] ===================
+// One connection per session, all driven from one poll() loop. Each session
+// loads level 1 and then sends one command at a time, paced to movesPerSec:
+// mostly single moves, some undos and board reads, and a reload once solved
+// or after 200 moves. Move round trips are timed from send to reply.
+
+#define LOAD_MAX_SAMPLES (1 << 24)
+
+typedef struct {
+    double sentAt;              // 0 = no request outstanding
+    double nextAt;
+    bool timed;                 // the outstanding request is a move
+    bool reload;
+    char line[512];             // reply being received (longer ones are cut)
+    int lineLen;
+} Bot;
+
+static int CompareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Ask the server for "stats" on its own connection: CPU seconds, or -1
+static double ServerCpu(const char *addr) {
+    int fd = ConnectTo(addr);
+    if (fd < 0) return -1;
+    char buf[256];
+    int len = 0, sessions;
+    double cpu = -1, t0 = NowSeconds();
+    long long commands;
+    if (send(fd, "stats\n", 6, MSG_NOSIGNAL) == 6) {
+        while (len < (int)sizeof(buf) - 1 && NowSeconds() - t0 < 5) {
+            struct pollfd p = { fd, POLLIN, 0 };
+            if (poll(&p, 1, 100) <= 0) continue;
+            ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - (size_t)len, 0);
+            if (n <= 0) break;
+            len += (int)n;
+            buf[len] = 0;
+            if (strchr(buf, '\n')) {
+                if (sscanf(buf, "ok %d %lf %lld", &sessions, &cpu, &commands) != 3) cpu = -1;
+                break;
+            }
+        }
+    }
+    close(fd);
+    return cpu;
+}
+
+static int RunLoadTest(const char *addr, int sessions, double seconds, double rate) {
+    if (sessions < 1) sessions = 1000;
+    if (seconds <= 0) seconds = 5;
+    signal(SIGPIPE, SIG_IGN);
+    RaiseFileLimit();
+    struct pollfd *pfds = calloc((size_t)sessions, sizeof(*pfds));
+    Bot *bots = calloc((size_t)sessions, sizeof(*bots));
+    double *samples = malloc(LOAD_MAX_SAMPLES * sizeof(double));
+    if (!pfds || !bots || !samples) { fprintf(stderr, "out of memory\n"); free(pfds); free(bots); free(samples); return 1; }
+    int open = 0;
+    for (; open < sessions; open++) {
+        pfds[open] = (struct pollfd){ ConnectTo(addr), POLLIN, 0 };
+        if (pfds[open].fd < 0) break;
+    }
+    if (open < sessions) fprintf(stderr, "connected %d of %d sessions\n", open, sessions);
+    sessions = open;
+
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    double cpu0 = ServerCpu(addr), t0 = NowSeconds(), end = t0 + seconds, interval = rate > 0 ? 1 / rate : 0;
+    long long sent = 0, moves = 0, errors = 0, count = 0;
+    for (int i = 0; i < sessions; i++) {
+        bots[i].reload = true;
+        bots[i].nextAt = t0 + interval * i / sessions;     // spread the first requests over one interval
+    }
+    int closed = 0;
+    char buf[4096];
+    while (closed < sessions) {
+        double now = NowSeconds(), wake = end;
+        for (int i = 0; i < sessions; i++) {
+            Bot *b = &bots[i];
+            if (pfds[i].fd < 0 || b->sentAt > 0) continue;
+            if (now >= end) { close(pfds[i].fd); pfds[i].fd = -1; closed++; continue; }
+            if (b->nextAt > now) { if (b->nextAt < wake) wake = b->nextAt; continue; }
+            char cmd[32];
+            uint64_t r = rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            int kind = (int)(r >> 33) % 20;
+            b->timed = false;
+            if (b->reload) { strcpy(cmd, "load 1\n"); b->reload = false; }
+            else if (kind < 17) { snprintf(cmd, sizeof(cmd), "move %c\n", "udlr"[(r >> 40) & 3]); b->timed = true; }
+            else if (kind < 19) strcpy(cmd, "undo\n");
+            else strcpy(cmd, "state\n");
+            size_t len = strlen(cmd);
+            if (send(pfds[i].fd, cmd, len, MSG_NOSIGNAL) != (ssize_t)len) { errors++; close(pfds[i].fd); pfds[i].fd = -1; closed++; continue; }
+            b->sentAt = now;
+            b->nextAt = b->nextAt + interval > now ? b->nextAt + interval : now;
+            sent++;
+        }
+        int timeout = (int)((wake - NowSeconds()) * 1e3);
+        if (poll(pfds, (nfds_t)sessions, timeout > 0 ? timeout : 0) <= 0) continue;
+        now = NowSeconds();
+        for (int i = 0; i < sessions; i++) {
+            if (pfds[i].fd < 0 || !(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            Bot *b = &bots[i];
+            ssize_t n = recv(pfds[i].fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+                errors++;
+                close(pfds[i].fd);
+                pfds[i].fd = -1;
+                closed++;
+                continue;
+            }
+            for (ssize_t k = 0; k < n; k++) {
+                if (buf[k] != '\n') {
+                    if (b->lineLen < (int)sizeof(b->line) - 1) b->line[b->lineLen++] = buf[k];
+                    continue;
+                }
+                b->line[b->lineLen] = 0;
+                b->lineLen = 0;
+                if (strncmp(b->line, "ok", 2) != 0) errors++;
+                if (b->timed) {
+                    int applied, made, solved;
+                    if (count < LOAD_MAX_SAMPLES) samples[count++] = (now - b->sentAt) * 1e3;
+                    moves++;
+                    if (sscanf(b->line, "ok %d %d %d", &applied, &made, &solved) == 3 && (solved || made >= 200)) b->reload = true;
+                }
+                b->sentAt = 0;
+            }
+        }
+    }
+    double wall = NowSeconds() - t0, cpu1 = ServerCpu(addr);
+
+    qsort(samples, (size_t)count, sizeof(double), CompareDoubles);
+    printf("%d sessions, %.1f s: %lld requests (%lld moves, %.0f moves/sec), %lld errors\n",
+           sessions, wall, sent, moves, moves / wall, errors);
+    if (count) printf("move latency ms: p50 %.3f  p99 %.3f  max %.3f\n",
+                      samples[count / 2], samples[(size_t)(count * 0.99)], samples[count - 1]);
+    if (cpu0 >= 0 && cpu1 > cpu0) {
+        double cores = (cpu1 - cpu0) / wall;
+        printf("server used %.1f%% of a core: %.0f sessions per core at %.0f requests/sec each\n",
+               cores * 100, sessions / cores, sent / wall / (sessions ? sessions : 1));
+    }
+    free(pfds);
+    free(bots);
+    free(samples);
+    return errors ? 2 : 0;
+}
+// ========================================================================
+
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--serve") == 0)
+        return RunServer(argv[2], argc > 3 ? argv[3] : NULL, argc > 4 ? atoi(argv[4]) : 0);
+    if (argc > 2 && strcmp(argv[1], "--load-test") == 0)
+        return RunLoadTest(argv[2], argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atof(argv[4]) : 0, argc > 5 ? atof(argv[5]) : 10);
+    fprintf(stderr, "usage: %s --serve unix:/path|tcp:PORT [pack.xsb] [maxSessions]\n"
+                    "       %s --load-test unix:/path|tcp:PORT [sessions] [seconds] [movesPerSec]\n", argv[0], argv[0]);
+    return 1;
+}
+#endif